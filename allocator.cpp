@@ -0,0 +1,376 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include "allocator.h"
+#include "log.h"
+
+using namespace vk;
+
+void vulkanMemoryBackend::init(Device dev, PhysicalDevice gpu) {
+	device = dev;
+	memProperties = gpu.getMemoryProperties();
+}
+
+DeviceMemory vulkanMemoryBackend::allocate(uint32_t memoryType, DeviceSize size, Buffer dedicatedBuffer, Image dedicatedImage) {
+	MemoryDedicatedAllocateInfo dedicatedInfo{
+		.image = dedicatedImage,
+		.buffer = dedicatedBuffer
+	};
+	bool dedicated = dedicatedBuffer || dedicatedImage;
+
+	MemoryAllocateInfo allocInfo{
+		.pNext = dedicated ? &dedicatedInfo : nullptr,
+		.allocationSize = size,
+		.memoryTypeIndex = memoryType
+	};
+
+	try {
+		return device.allocateMemory(allocInfo);
+	}
+	catch (const SystemError&) {
+		return nullptr;
+	}
+}
+
+void vulkanMemoryBackend::free(DeviceMemory memory) {
+	device.freeMemory(memory);
+}
+
+void* vulkanMemoryBackend::map(DeviceMemory memory, DeviceSize size) {
+	return device.mapMemory(memory, 0, size);
+}
+
+void fakeMemoryBackend::init(DeviceSize deviceHeapSize, DeviceSize hostHeapSize) {
+	memProperties = PhysicalDeviceMemoryProperties{};
+	memProperties.memoryTypeCount = 2;
+	memProperties.memoryTypes[0] = { .propertyFlags = MemoryPropertyFlagBits::eDeviceLocal, .heapIndex = 0 };
+	memProperties.memoryTypes[1] = { .propertyFlags = MemoryPropertyFlagBits::eHostVisible | MemoryPropertyFlagBits::eHostCoherent,
+		.heapIndex = 1 };
+	memProperties.memoryHeapCount = 2;
+	memProperties.memoryHeaps[0] = { .size = deviceHeapSize, .flags = MemoryHeapFlagBits::eDeviceLocal };
+	memProperties.memoryHeaps[1] = { .size = hostHeapSize, .flags = {} };
+	heapUsed.assign(2, 0);
+}
+
+DeviceMemory fakeMemoryBackend::allocate(uint32_t memoryType, DeviceSize size, Buffer, Image) {
+	uint32_t heap = memProperties.memoryTypes[memoryType].heapIndex;
+	if (heapUsed[heap] + size > memProperties.memoryHeaps[heap].size) {
+		return nullptr;
+	}
+	heapUsed[heap] += size;
+
+	VkDeviceMemory handle = reinterpret_cast<VkDeviceMemory>(nextHandle++);
+	objects[handle] = { memoryType, size, nullptr };
+	return DeviceMemory(handle);
+}
+
+void fakeMemoryBackend::free(DeviceMemory memory) {
+	auto found = objects.find(static_cast<VkDeviceMemory>(memory));
+	if (found == objects.end()) {
+		return;
+	}
+	heapUsed[memProperties.memoryTypes[found->second.memoryType].heapIndex] -= found->second.size;
+	objects.erase(found);
+}
+
+void* fakeMemoryBackend::map(DeviceMemory memory, DeviceSize) {
+	object& o = objects.at(static_cast<VkDeviceMemory>(memory));
+	if (!o.host) {
+		o.host = std::make_unique<uint8_t[]>(o.size);
+	}
+	return o.host.get();
+}
+
+void gpuAllocator::init(memoryBackend* memBackend, DeviceSize blockSize) {
+	backend = memBackend;
+	preferredBlockSize = blockSize;
+	dedicatedStats.assign(backend->properties().memoryHeapCount, heapStats{});
+}
+
+void gpuAllocator::destroy() {
+	for (auto& b : blocks) {
+		if (b.memory) {
+			backend->free(b.memory);
+		}
+	}
+	blocks.clear();
+	freeBlockSlots.clear();
+}
+
+bool gpuAllocator::allocate(const MemoryRequirements& req, MemoryPropertyFlags required, resourceKind kind,
+	bool dedicated, allocation& out, Buffer dedicatedBuffer, Image dedicatedImage) {
+	const auto& props = backend->properties();
+
+	for (uint32_t i = 0; i < props.memoryTypeCount; i++) {
+		if (!(req.memoryTypeBits & (1u << i)) || (props.memoryTypes[i].propertyFlags & required) != required) {
+			continue;
+		}
+
+		// anything above half a block would mostly waste the rest of it
+		if (dedicated || req.size > blockSizeFor(i) / 2) {
+			if (allocateDedicated(i, req, out, dedicatedBuffer, dedicatedImage)) {
+				return true;
+			}
+		}
+		else if (allocateFrom(i, req, kind, out)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool gpuAllocator::allocateFrom(uint32_t memoryType, const MemoryRequirements& req, resourceKind kind, allocation& out) {
+	for (uint32_t i = 0; i < blocks.size(); i++) {
+		block& b = blocks[i];
+		if (!b.memory || b.memoryType != memoryType || b.kind != kind) {
+			continue;
+		}
+		uint64_t offset;
+		uint32_t node = b.ranges->allocate(req.size, req.alignment, offset);
+		if (node != tlsf::invalid) {
+			out = { b.memory, offset, req.size, b.mapped ? b.mapped + offset : nullptr, memoryType, i, node };
+			return true;
+		}
+	}
+
+	// no room anywhere, open a new block; shrink it if the heap is too fragmented for a full one
+	DeviceSize size = blockSizeFor(memoryType);
+	DeviceMemory memory;
+	while (!(memory = backend->allocate(memoryType, size, nullptr, nullptr))) {
+		if (size / 2 < req.size + req.alignment) {
+			return false;
+		}
+		size /= 2;
+	}
+
+	uint32_t slot;
+	if (!freeBlockSlots.empty()) {
+		slot = freeBlockSlots.back();
+		freeBlockSlots.pop_back();
+	}
+	else {
+		slot = static_cast<uint32_t>(blocks.size());
+		blocks.emplace_back();
+	}
+
+	block& b = blocks[slot];
+	b.memory = memory;
+	b.memoryType = memoryType;
+	b.kind = kind;
+	b.mapped = hostVisible(memoryType) ? static_cast<uint8_t*>(backend->map(memory, size)) : nullptr;
+	b.ranges = std::make_unique<tlsf>();
+	b.ranges->init(size);
+
+	LOG_INFO("memory block allocated: " << size / (1024 * 1024) << " MB of type " << memoryType);
+
+	uint64_t offset;
+	uint32_t node = b.ranges->allocate(req.size, req.alignment, offset);
+	out = { b.memory, offset, req.size, b.mapped ? b.mapped + offset : nullptr, memoryType, slot, node };
+	return true;
+}
+
+bool gpuAllocator::allocateDedicated(uint32_t memoryType, const MemoryRequirements& req, allocation& out,
+	Buffer dedicatedBuffer, Image dedicatedImage) {
+	DeviceMemory memory = backend->allocate(memoryType, req.size, dedicatedBuffer, dedicatedImage);
+	if (!memory) {
+		return false;
+	}
+
+	void* mapped = hostVisible(memoryType) ? backend->map(memory, req.size) : nullptr;
+	out = { memory, 0, req.size, mapped, memoryType, UINT32_MAX, UINT32_MAX };
+
+	heapStats& s = dedicatedStats[backend->properties().memoryTypes[memoryType].heapIndex];
+	s.dedicatedCount++;
+	s.dedicatedBytes += req.size;
+	return true;
+}
+
+void gpuAllocator::free(allocation& a) {
+	if (!a.memory) {
+		return;
+	}
+
+	if (a.block == UINT32_MAX) {
+		backend->free(a.memory);
+		heapStats& s = dedicatedStats[backend->properties().memoryTypes[a.memoryType].heapIndex];
+		s.dedicatedCount--;
+		s.dedicatedBytes -= a.size;
+		a = {};
+		return;
+	}
+
+	block& b = blocks[a.block];
+	b.ranges->free(a.node);
+
+	// give an empty block back unless it is the last one of its kind, which avoids churn
+	// when a single resource is created and destroyed repeatedly
+	if (b.ranges->empty()) {
+		bool another = false;
+		for (uint32_t i = 0; i < blocks.size(); i++) {
+			if (i != a.block && blocks[i].memory && blocks[i].memoryType == b.memoryType && blocks[i].kind == b.kind) {
+				another = true;
+				break;
+			}
+		}
+		if (another) {
+			backend->free(b.memory);
+			b = {};
+			freeBlockSlots.push_back(a.block);
+		}
+	}
+
+	a = {};
+}
+
+uint32_t gpuAllocator::heapCount() const {
+	return backend->properties().memoryHeapCount;
+}
+
+heapStats gpuAllocator::stats(uint32_t heap) const {
+	const auto& props = backend->properties();
+
+	heapStats s = dedicatedStats[heap];
+	s.heapSize = props.memoryHeaps[heap].size;
+	s.allocationCount = s.dedicatedCount;
+	for (const auto& b : blocks) {
+		if (!b.memory || props.memoryTypes[b.memoryType].heapIndex != heap) {
+			continue;
+		}
+		s.blockCount++;
+		s.blockBytes += b.ranges->capacity();
+		s.usedBytes += b.ranges->used();
+		s.allocationCount += b.ranges->allocationCount();
+	}
+	return s;
+}
+
+DeviceSize gpuAllocator::blockSizeFor(uint32_t memoryType) const {
+	const auto& props = backend->properties();
+	// small heaps (e.g. the 256 MB host-visible BAR window) get proportionally small blocks
+	DeviceSize heapSize = props.memoryHeaps[props.memoryTypes[memoryType].heapIndex].size;
+	return std::min(preferredBlockSize, heapSize / 8);
+}
+
+bool gpuAllocator::hostVisible(uint32_t memoryType) const {
+	return bool(backend->properties().memoryTypes[memoryType].propertyFlags & MemoryPropertyFlagBits::eHostVisible);
+}
+
+bool allocatorSelfTest() {
+	bool passed = true;
+	auto check = [&](bool condition, const char* what) {
+		if (!condition) {
+			LOG_ERROR("allocator self-test failed: " << what);
+			passed = false;
+		}
+	};
+
+	// tlsf alone: alignment, and free neighbours merging back into one range
+	{
+		tlsf ranges;
+		ranges.init(4096);
+		uint64_t a, b, c, d;
+		uint32_t na = ranges.allocate(100, 1, a);
+		uint32_t nb = ranges.allocate(100, 256, b);
+		uint32_t nc = ranges.allocate(1000, 1024, c);
+		check(na != tlsf::invalid && nb != tlsf::invalid && nc != tlsf::invalid, "tlsf allocations fit");
+		check(b % 256 == 0 && c % 1024 == 0, "tlsf offsets honour the alignment");
+		check(b >= a + 100 && c >= b + 100, "tlsf ranges do not overlap");
+		check(ranges.allocationCount() == 3 && ranges.used() == 1200, "tlsf counts live bytes");
+
+		ranges.free(na);
+		ranges.free(nb);
+		ranges.free(nc);
+		check(ranges.empty() && ranges.used() == 0, "tlsf is empty after freeing everything");
+		uint32_t nd = ranges.allocate(4096, 1, d);
+		check(nd != tlsf::invalid && d == 0, "freed neighbours merge back into the whole range");
+		ranges.free(nd);
+
+		// a hole between two live ranges only merges with the side that is free
+		uint32_t n1 = ranges.allocate(1024, 1, a);
+		uint32_t n2 = ranges.allocate(1024, 1, b);
+		uint32_t n3 = ranges.allocate(1024, 1, c);
+		ranges.free(n1);
+		ranges.free(n2);
+		uint32_t n4 = ranges.allocate(2048, 1, d);
+		check(n4 != tlsf::invalid && d == a, "two freed neighbours hold a range of their combined size");
+		ranges.free(n3);
+		ranges.free(n4);
+	}
+
+	fakeMemoryBackend backend;
+	backend.init(256ull * 1024 * 1024, 64ull * 1024 * 1024);
+	gpuAllocator allocator;
+	// the host heap caps its blocks at 8 MB, the device heap's at 16 MB
+	allocator.init(&backend, 16ull * 1024 * 1024);
+
+	const MemoryPropertyFlags deviceLocal = MemoryPropertyFlagBits::eDeviceLocal;
+	const MemoryPropertyFlags hostVisible = MemoryPropertyFlagBits::eHostVisible;
+	MemoryRequirements small{ .size = 1000, .alignment = 256, .memoryTypeBits = 0x3 };
+
+	// alignment through the block allocator
+	allocation linear[4];
+	for (auto& a : linear) {
+		check(allocator.allocate(small, deviceLocal, resourceKind::linear, false, a), "small linear allocation");
+		check(a.offset % small.alignment == 0, "block offsets honour the alignment");
+		check(a.memoryType == 0 && a.block != UINT32_MAX, "device-local allocations come from type 0 blocks");
+	}
+	check(linear[0].memory == linear[3].memory, "small allocations share a block");
+
+	// bufferImageGranularity: optimal-tiling resources never land in a linear block
+	allocation optimal;
+	check(allocator.allocate(small, deviceLocal, resourceKind::optimal, false, optimal), "small optimal allocation");
+	check(optimal.block != linear[0].block && optimal.memory != linear[0].memory,
+		"linear and optimal resources use separate blocks");
+
+	// dedicated on request, and for anything over half a block
+	uint32_t blockObjects = backend.liveCount();
+	allocation dedicated, large;
+	MemoryRequirements big{ .size = 12ull * 1024 * 1024, .alignment = 4096, .memoryTypeBits = 0x1 };
+	check(allocator.allocate(small, deviceLocal, resourceKind::optimal, true, dedicated), "dedicated allocation");
+	check(dedicated.block == UINT32_MAX && dedicated.offset == 0, "dedicated allocations own their memory");
+	check(allocator.allocate(big, deviceLocal, resourceKind::linear, false, large), "large allocation");
+	check(large.block == UINT32_MAX, "allocations over half a block become dedicated");
+	check(backend.liveCount() == blockObjects + 2, "each dedicated allocation is its own memory object");
+
+	// host-visible memory comes back mapped at its offset
+	allocation upload;
+	check(allocator.allocate(small, hostVisible, resourceKind::linear, false, upload), "host-visible allocation");
+	check(upload.memoryType == 1 && upload.mapped != nullptr, "host-visible allocations are mapped");
+
+	// stats per heap
+	heapStats device = allocator.stats(0);
+	check(device.blockCount == 2 && device.blockBytes == 2 * 16ull * 1024 * 1024, "device heap reports its blocks");
+	check(device.allocationCount == 7 && device.usedBytes == 5 * small.size, "device heap counts its allocations");
+	check(device.dedicatedCount == 2 && device.dedicatedBytes == small.size + big.size, "device heap counts dedicated bytes");
+	heapStats host = allocator.stats(1);
+	check(host.blockCount == 1 && host.blockBytes == 8ull * 1024 * 1024 && host.allocationCount == 1, "host heap reports its block");
+
+	// freeing merges the ranges back, so a block-sized request fits the emptied block again
+	for (auto& a : linear) {
+		allocator.free(a);
+	}
+	allocation whole;
+	MemoryRequirements half{ .size = 8ull * 1024 * 1024, .alignment = 256, .memoryTypeBits = 0x1 };
+	check(allocator.allocate(half, deviceLocal, resourceKind::linear, false, whole), "half-block allocation");
+	check(whole.offset == 0 && whole.block != UINT32_MAX, "freed ranges merge so the block can be reused from the start");
+
+	allocator.free(whole);
+	allocator.free(optimal);
+	allocator.free(dedicated);
+	allocator.free(large);
+	allocator.free(upload);
+	device = allocator.stats(0);
+	check(device.allocationCount == 0 && device.usedBytes == 0 && device.dedicatedBytes == 0, "stats return to zero");
+	// the last empty block of each kind stays for reuse
+	check(backend.liveCount() == 3, "only the kept empty blocks remain");
+
+	allocator.destroy();
+	check(backend.liveCount() == 0, "destroy frees every block");
+
+	if (passed) {
+		LOG_INFO("allocator self-test passed");
+	}
+	return passed;
+}
@@ -0,0 +1,194 @@
+#include "cpuprofiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+cpuProfiler cpuProfile;
+
+namespace {
+	// the calling thread's ring, registered on its first zone
+	thread_local void* localRing = nullptr;
+}
+
+cpuProfiler::cpuProfiler() {
+	originTicks = now();
+	originTime = std::chrono::steady_clock::now();
+	pending.reserve(ringSize);
+	trace.resize(traceFrames);
+}
+
+cpuProfiler::threadRing* cpuProfiler::registerThread() {
+	auto ring = std::make_unique<threadRing>();
+	threadRing* raw = ring.get();
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		raw->index = static_cast<uint32_t>(rings.size());
+		raw->name = "thread " + std::to_string(raw->index);
+		// never freed before the profiler; the consumer may still be draining an exited thread
+		rings.push_back(std::move(ring));
+	}
+	localRing = raw;
+	return raw;
+}
+
+void cpuProfiler::record(const char* name, uint64_t start, uint64_t end) {
+	threadRing* ring = static_cast<threadRing*>(localRing);
+	if (!ring) {
+		ring = registerThread();
+	}
+
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	if (head - ring->cachedTail >= ringSize) {
+		ring->cachedTail = ring->tail.load(std::memory_order_acquire);
+		if (head - ring->cachedTail >= ringSize) {
+			// the consumer is more than a ring behind; losing a zone beats stalling the caller
+			ring->dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+	ring->events[head % ringSize] = { name, start, end };
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void cpuProfiler::setThreadName(const std::string& name) {
+	threadRing* ring = static_cast<threadRing*>(localRing);
+	if (!ring) {
+		ring = registerThread();
+	}
+	std::lock_guard<std::mutex> lock(ringMutex);
+	ring->name = name;
+}
+
+double cpuProfiler::ticksToUs(uint64_t ticks) const {
+	return double(ticks - originTicks) * usPerTick;
+}
+
+void cpuProfiler::frameMark() {
+	uint64_t frameEnd = now();
+
+	// the longer the baseline, the more exact the tick rate
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - originTime;
+	if (frameEnd > originTicks) {
+		usPerTick = elapsed.count() / double(frameEnd - originTicks);
+	}
+
+	if (lastFrameTicks) {
+		record("frame", lastFrameTicks, frameEnd);
+	}
+	lastFrameTicks = frameEnd;
+
+	pending.clear();
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (auto& ring : rings) {
+			uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			for (; tail != head; tail++) {
+				const event& e = ring->events[tail % ringSize];
+				pending.push_back({ e.name, ring->index, ticksToUs(e.start), double(e.end - e.start) * usPerTick });
+			}
+			ring->tail.store(tail, std::memory_order_release);
+		}
+	}
+
+	// per-zone totals for this frame, in the order zones were first seen
+	frameZones.clear();
+	for (const auto& e : pending) {
+		auto found = historyIndex.find(e.name);
+		if (found == historyIndex.end()) {
+			// the same name may come from literals at different addresses, one per translation unit
+			size_t zone = std::find_if(histories.begin(), histories.end(), [&](const history& h) {
+				return h.name == e.name;
+			}) - histories.begin();
+			if (zone == histories.size()) {
+				histories.emplace_back().name = e.name;
+			}
+			found = historyIndex.emplace(e.name, zone).first;
+		}
+		history& h = histories[found->second];
+		if (h.frameCalls == 0) {
+			frameZones.push_back(found->second);
+		}
+		h.frameMs += e.durationUs * 1e-3;
+		h.frameCalls++;
+	}
+
+	for (size_t zone : frameZones) {
+		history& h = histories[zone];
+		if (h.samples.size() < historySize) {
+			h.samples.push_back(h.frameMs);
+		}
+		else {
+			h.samples[h.next] = h.frameMs;
+		}
+		h.next = (h.next + 1) % historySize;
+		h.lastMs = h.frameMs;
+		h.lastCalls = h.frameCalls;
+		h.frameMs = 0.0;
+		h.frameCalls = 0;
+	}
+
+	// the slot swapped out holds the oldest frame, whose storage the next frame fills
+	std::swap(trace[traceNext], pending);
+	traceNext = (traceNext + 1) % traceFrames;
+	traceCount = std::min(traceCount + 1, traceFrames);
+}
+
+std::vector<cpuProfiler::zoneStats> cpuProfiler::stats() const {
+	std::vector<zoneStats> out;
+	out.reserve(histories.size());
+
+	for (const auto& h : histories) {
+		zoneStats s{ .name = h.name, .lastMs = h.lastMs, .lastCalls = h.lastCalls,
+		.samples = static_cast<uint32_t>(h.samples.size()) };
+		double sum = 0.0;
+		for (double v : h.samples) {
+			sum += v;
+			s.maxMs = std::max(s.maxMs, v);
+		}
+		if (!h.samples.empty()) {
+			s.avgMs = sum / h.samples.size();
+		}
+		out.push_back(s);
+	}
+	return out;
+}
+
+uint64_t cpuProfiler::dropped() const {
+	std::lock_guard<std::mutex> lock(ringMutex);
+	uint64_t total = 0;
+	for (const auto& ring : rings) {
+		total += ring->dropped.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+bool cpuProfiler::writeChromeTrace(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+
+	// fixed notation keeps sub-microsecond digits in long traces
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (const auto& ring : rings) {
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->index
+				<< ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+			first = false;
+		}
+	}
+	for (uint32_t i = 0; i < traceCount; i++) {
+		for (const auto& event : trace[(traceNext + traceFrames - traceCount + i) % traceFrames]) {
+			file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+				<< event.thread << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+			first = false;
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,278 @@
+#include "culling.h"
+#include "log.h"
+#include "meshlet.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define R2E_CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define R2E_TARGET_AVX2
+#else
+#define R2E_TARGET_AVX2 __attribute__((target("avx2,fma,popcnt")))
+#endif
+#else
+#define R2E_CULL_X86 0
+#endif
+
+uint32_t cullBounds::add(glm::vec3 center, glm::vec3 extent) {
+	uint32_t index = count++;
+	if (centerX.size() < count) {
+		// padding never passes: a NaN centre fails every comparison
+		size_t padded = (count + batch - 1) / batch * batch;
+		float nan = std::numeric_limits<float>::quiet_NaN();
+		for (auto* column : { &centerX, &centerY, &centerZ }) {
+			column->resize(padded, nan);
+		}
+		for (auto* column : { &extentX, &extentY, &extentZ }) {
+			column->resize(padded, 0.0f);
+		}
+	}
+	set(index, center, extent);
+	return index;
+}
+
+void cullBounds::set(uint32_t index, glm::vec3 center, glm::vec3 extent) {
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extent.x;
+	extentY[index] = extent.y;
+	extentZ[index] = extent.z;
+}
+
+void cullBounds::clear() {
+	for (auto* column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+		column->clear();
+	}
+	count = 0;
+}
+
+namespace {
+	// a box is outside a plane when even its corner furthest along the normal is behind it:
+	// dot(n, c) + w + dot(|n|, e) < 0. rounding differs between paths (the AVX2 one fuses its
+	// multiply-adds), so boxes touching a plane to within an ulp may land either way
+
+	uint32_t cullScalar(const cullBounds& b, const glm::vec4 (&planes)[6], uint32_t* out) {
+		const float *cx = b.centerX.data(), *cy = b.centerY.data(), *cz = b.centerZ.data();
+		const float *ex = b.extentX.data(), *ey = b.extentY.data(), *ez = b.extentZ.data();
+		glm::vec3 absN[6];
+		for (int p = 0; p < 6; p++) {
+			absN[p] = glm::abs(glm::vec3(planes[p]));
+		}
+
+		uint32_t written = 0;
+		for (uint32_t i = 0; i < b.count; i++) {
+			bool inside = true;
+			for (int p = 0; p < 6; p++) {
+				float d = planes[p].x * cx[i] + planes[p].y * cy[i] + planes[p].z * cz[i] + planes[p].w
+					+ absN[p].x * ex[i] + absN[p].y * ey[i] + absN[p].z * ez[i];
+				inside &= d >= 0.0f;
+			}
+			// written unconditionally, kept only when inside: visibility is too random to branch on
+			out[written] = i;
+			written += inside;
+		}
+		return written;
+	}
+
+#if R2E_CULL_X86
+	uint32_t cullSse(const cullBounds& b, const glm::vec4 (&planes)[6], uint32_t* out) {
+		__m128 n[6][3], absN[6][3], w[6];
+		for (int p = 0; p < 6; p++) {
+			for (int k = 0; k < 3; k++) {
+				n[p][k] = _mm_set1_ps(planes[p][k]);
+				absN[p][k] = _mm_set1_ps(std::abs(planes[p][k]));
+			}
+			w[p] = _mm_set1_ps(planes[p].w);
+		}
+
+		uint32_t written = 0;
+		for (uint32_t i = 0; i < b.count; i += 4) {
+			__m128 cx = _mm_loadu_ps(&b.centerX[i]), cy = _mm_loadu_ps(&b.centerY[i]), cz = _mm_loadu_ps(&b.centerZ[i]);
+			__m128 ex = _mm_loadu_ps(&b.extentX[i]), ey = _mm_loadu_ps(&b.extentY[i]), ez = _mm_loadu_ps(&b.extentZ[i]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (int p = 0; p < 6; p++) {
+				__m128 d = _mm_add_ps(_mm_mul_ps(n[p][0], cx), w[p]);
+				d = _mm_add_ps(_mm_mul_ps(n[p][1], cy), d);
+				d = _mm_add_ps(_mm_mul_ps(n[p][2], cz), d);
+				d = _mm_add_ps(_mm_mul_ps(absN[p][0], ex), d);
+				d = _mm_add_ps(_mm_mul_ps(absN[p][1], ey), d);
+				d = _mm_add_ps(_mm_mul_ps(absN[p][2], ez), d);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+			}
+
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			for (uint32_t lane = 0; lane < 4; lane++) {
+				out[written] = i + lane;
+				written += (mask >> lane) & 1;
+			}
+		}
+		return written;
+	}
+
+	// left-pack table: for every 8-bit lane mask, the set lanes' numbers packed 4 bits each from the bottom
+	constexpr std::array<uint32_t, 256> makePackTable() {
+		std::array<uint32_t, 256> table{};
+		for (uint32_t mask = 0; mask < 256; mask++) {
+			uint32_t packed = 0, slot = 0;
+			for (uint32_t lane = 0; lane < 8; lane++) {
+				if (mask & (1u << lane)) {
+					packed |= lane << (4 * slot++);
+				}
+			}
+			table[mask] = packed;
+		}
+		return table;
+	}
+	constexpr std::array<uint32_t, 256> packTable = makePackTable();
+
+	R2E_TARGET_AVX2 uint32_t cullAvx2(const cullBounds& b, const glm::vec4 (&planes)[6], uint32_t* out) {
+		const __m256i nibbleShifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+		const __m256i nibble = _mm256_set1_epi32(0xf);
+
+		// d + r as one chain of fused multiply-adds: n.c + |n|.e + w
+		__m256 n[6][3], absN[6][3], w[6];
+		for (int p = 0; p < 6; p++) {
+			for (int k = 0; k < 3; k++) {
+				n[p][k] = _mm256_set1_ps(planes[p][k]);
+				absN[p][k] = _mm256_set1_ps(std::abs(planes[p][k]));
+			}
+			w[p] = _mm256_set1_ps(planes[p].w);
+		}
+
+		uint32_t written = 0;
+		for (uint32_t i = 0; i < b.count; i += 8) {
+			__m256 cx = _mm256_loadu_ps(&b.centerX[i]), cy = _mm256_loadu_ps(&b.centerY[i]), cz = _mm256_loadu_ps(&b.centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&b.extentX[i]), ey = _mm256_loadu_ps(&b.extentY[i]), ez = _mm256_loadu_ps(&b.extentZ[i]);
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+			for (int p = 0; p < 6; p++) {
+				__m256 d = _mm256_fmadd_ps(n[p][0], cx, w[p]);
+				d = _mm256_fmadd_ps(n[p][1], cy, d);
+				d = _mm256_fmadd_ps(n[p][2], cz, d);
+				d = _mm256_fmadd_ps(absN[p][0], ex, d);
+				d = _mm256_fmadd_ps(absN[p][1], ey, d);
+				d = _mm256_fmadd_ps(absN[p][2], ez, d);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+
+			// all eight lanes are stored; the next batch overwrites the ones past the visible count
+			uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+			__m256i lanes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(packTable[mask])), nibbleShifts), nibble);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + written), _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(i))));
+			written += std::popcount(mask);
+		}
+		return written;
+	}
+
+	// the AVX2 path also fuses its multiply-adds, and every AVX2 CPU has FMA3 besides
+	bool cpuHasAvx2() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		// the OS must save ymm registers: OSXSAVE and AVX, then XCR0 bits 1 and 2
+		bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		bool fma = info[2] & (1 << 12);
+		__cpuidex(info, 7, 0);
+		return osAvx && fma && (info[1] & (1 << 5));
+#else
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}
+#endif
+}
+
+cullPath bestCullPath() {
+#if R2E_CULL_X86
+	static const cullPath best = cpuHasAvx2() ? cullPath::avx2 : cullPath::sse;
+	return best;
+#else
+	return cullPath::scalar;
+#endif
+}
+
+const char* to_string(cullPath path) {
+	switch (path) {
+	case cullPath::scalar: return "scalar";
+	case cullPath::sse: return "sse";
+	case cullPath::avx2: return "avx2";
+	}
+	return "?";
+}
+
+uint32_t cullFrustum(const cullBounds& bounds, const glm::vec4 (&planes)[6], std::vector<uint32_t>& visible, cullPath path) {
+	// room for every object plus the AVX2 path's full-batch stores; never shrunk, so a list reused
+	// across frames is not refilled each time
+	if (visible.size() < bounds.centerX.size()) {
+		visible.resize(bounds.centerX.size());
+	}
+	if (path > bestCullPath()) {
+		path = bestCullPath();
+	}
+
+	uint32_t written = 0;
+	switch (path) {
+#if R2E_CULL_X86
+	case cullPath::avx2:
+		written = cullAvx2(bounds, planes, visible.data());
+		break;
+	case cullPath::sse:
+		written = cullSse(bounds, planes, visible.data());
+		break;
+#endif
+	default:
+		written = cullScalar(bounds, planes, visible.data());
+		break;
+	}
+
+	return written;
+}
+
+void benchmarkCulling(uint32_t objectCount, uint32_t iterations) {
+	// cars spread over a 2 km square, seen from above one corner with a 60 degree lens
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> ground(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> size(1.0f, 3.0f);
+	cullBounds bounds;
+	for (uint32_t i = 0; i < objectCount; i++) {
+		bounds.add({ ground(rng), size(rng), ground(rng) }, { size(rng), size(rng), size(rng) * 2.0f });
+	}
+
+	glm::vec3 eye(-900.0f, 50.0f, -900.0f);
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1500.0f);
+	glm::mat4 viewProj = proj * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	meshletCullView view = meshletCullView::fromPerspective(viewProj, eye);
+
+	std::vector<uint32_t> reference, visible;
+	reference.resize(cullFrustum(bounds, view.planes, reference, cullPath::scalar));
+
+	for (cullPath path : { cullPath::scalar, cullPath::sse, cullPath::avx2 }) {
+		if (path > bestCullPath()) {
+			break;
+		}
+		auto start = std::chrono::steady_clock::now();
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < iterations; i++) {
+			count = cullFrustum(bounds, view.planes, visible, path);
+		}
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+		bool matches = count == reference.size() && std::equal(reference.begin(), reference.end(), visible.begin());
+		LOG_INFO("cull " << objectCount << " objects, " << to_string(path) << ": " << elapsed.count() / iterations
+			<< " us, " << count << " visible" << (matches ? "" : " (differs from scalar)"));
+	}
+}
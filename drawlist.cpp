@@ -0,0 +1,67 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "drawlist.h"
+
+using namespace vk;
+
+void drawList::record(CommandBuffer cmd) const {
+	recordDraws(cmd, 0, draws.size());
+	recordCustom(cmd);
+}
+
+void drawList::recordDraws(CommandBuffer cmd, size_t first, size_t count) const {
+	Pipeline boundPipeline;
+	Buffer boundVb;
+	DeviceSize boundVbOffset = 0;
+	Buffer boundIb;
+	DeviceSize boundIbOffset = 0;
+	IndexType boundIndexType = IndexType::eUint32;
+	PipelineLayout boundLayout;
+	const void* boundPushConstants = nullptr;
+
+	for (size_t i = first; i < first + count; i++) {
+		const drawItem& item = draws[i];
+		if (!item.pipeline || (item.indirectBuffer && item.indirectCount == 0)) {
+			continue;
+		}
+		if (item.pipeline != boundPipeline) {
+			cmd.bindPipeline(PipelineBindPoint::eGraphics, item.pipeline);
+			boundPipeline = item.pipeline;
+		}
+		if (item.vertexBuffer != boundVb || item.vertexBufferOffset != boundVbOffset) {
+			cmd.bindVertexBuffers(0, 1, &item.vertexBuffer, &item.vertexBufferOffset);
+			boundVb = item.vertexBuffer;
+			boundVbOffset = item.vertexBufferOffset;
+		}
+		if (item.indexBuffer != boundIb || item.indexBufferOffset != boundIbOffset || item.indexType != boundIndexType) {
+			cmd.bindIndexBuffer(item.indexBuffer, item.indexBufferOffset, item.indexType);
+			boundIb = item.indexBuffer;
+			boundIbOffset = item.indexBufferOffset;
+			boundIndexType = item.indexType;
+		}
+		if (item.pushConstantSize && item.layout
+			&& (item.pushConstants != boundPushConstants || item.layout != boundLayout)) {
+			cmd.pushConstants(item.layout, ShaderStageFlagBits::eVertex, 0, item.pushConstantSize, item.pushConstants);
+			boundLayout = item.layout;
+			boundPushConstants = item.pushConstants;
+		}
+		if (!item.indirectBuffer) {
+			cmd.drawIndexed(item.indexCount, item.instanceCount, item.firstIndex, item.vertexOffset, item.firstInstance);
+		}
+		else if (multiDrawIndirect) {
+			cmd.drawIndexedIndirect(item.indirectBuffer, item.indirectOffset, item.indirectCount, sizeof(DrawIndexedIndirectCommand));
+		}
+		else {
+			for (uint32_t c = 0; c < item.indirectCount; c++) {
+				cmd.drawIndexedIndirect(item.indirectBuffer, item.indirectOffset + c * sizeof(DrawIndexedIndirectCommand), 1,
+					sizeof(DrawIndexedIndirectCommand));
+			}
+		}
+	}
+}
+
+void drawList::recordCustom(CommandBuffer cmd) const {
+	for (const auto& fn : recorders) {
+		fn(cmd);
+	}
+}
@@ -0,0 +1,182 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "gpuprofiler.h"
+#include "log.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+using namespace vk;
+
+void gpuProfiler::init(Device dev, PhysicalDevice gpu, uint32_t queueFamily, uint32_t framesInFlight) {
+	device = dev;
+
+	uint32_t validBits = gpu.getQueueFamilyProperties()[queueFamily].timestampValidBits;
+	if (validBits == 0) {
+		LOG_WARN("gpu profiler disabled: queue family has no timestamps");
+		return;
+	}
+	validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	periodNs = gpu.getProperties().limits.timestampPeriod;
+
+	slotCount = framesInFlight;
+	slots = std::make_unique<frameSlot[]>(slotCount);
+
+	// two queries per region, one slice per frame in flight
+	QueryPoolCreateInfo ci{ .queryType = QueryType::eTimestamp,
+	.queryCount = slotCount * maxRegions * 2 };
+	pool = device.createQueryPool(ci);
+
+	LOG_INFO("gpu profiler created");
+}
+
+void gpuProfiler::destroy() {
+	if (pool) {
+		device.destroyQueryPool(pool);
+		pool = nullptr;
+	}
+	slots.reset();
+}
+
+void gpuProfiler::beginFrame(CommandBuffer cmd, uint32_t slotIndex) {
+	if (!enabled()) {
+		return;
+	}
+	resolve(slotIndex);
+
+	currentSlot = slotIndex;
+	cmd.resetQueryPool(pool, slotIndex * maxRegions * 2, maxRegions * 2);
+}
+
+void gpuProfiler::submitted(uint32_t slotIndex) {
+	if (!enabled()) {
+		return;
+	}
+	slots[slotIndex].submitted = true;
+}
+
+uint32_t gpuProfiler::begin(CommandBuffer cmd, const char* name, PipelineStageFlagBits stage) {
+	if (!enabled()) {
+		return noRegion;
+	}
+	frameSlot& slot = slots[currentSlot];
+	uint32_t index = slot.regionCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= maxRegions) {
+		return noRegion;
+	}
+	slot.regions[index].name = name;
+	cmd.writeTimestamp(stage, pool, (currentSlot * maxRegions + index) * 2);
+	return index;
+}
+
+void gpuProfiler::end(CommandBuffer cmd, uint32_t region, PipelineStageFlagBits stage) {
+	if (region == noRegion) {
+		return;
+	}
+	cmd.writeTimestamp(stage, pool, (currentSlot * maxRegions + region) * 2 + 1);
+}
+
+void gpuProfiler::resolve(uint32_t slotIndex) {
+	frameSlot& slot = slots[slotIndex];
+	uint32_t count = std::min(slot.regionCount.load(std::memory_order_relaxed), maxRegions);
+	slot.regionCount.store(0, std::memory_order_relaxed);
+	bool submitted = slot.submitted;
+	slot.submitted = false;
+	if (count == 0 || !submitted) {
+		return;
+	}
+
+	// value + availability per query; the frame has completed, so nothing here waits
+	std::vector<uint64_t> data(count * 2 * 2);
+	Result result = device.getQueryPoolResults(pool, slotIndex * maxRegions * 2, count * 2,
+		data.size() * sizeof(uint64_t), data.data(), 2 * sizeof(uint64_t),
+		QueryResultFlagBits::e64 | QueryResultFlagBits::eWithAvailability);
+	if (result != Result::eSuccess && result != Result::eNotReady) {
+		return;
+	}
+
+	std::vector<traceEvent> events;
+	events.reserve(count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint64_t* first = &data[i * 4];
+		const uint64_t* second = &data[i * 4 + 2];
+		// a region that was never closed
+		if (!first[1] || !second[1]) {
+			continue;
+		}
+		uint64_t start = first[0] & validMask;
+		uint64_t stop = second[0] & validMask;
+		double ms = double((stop - start) & validMask) * periodNs * 1e-6;
+
+		const char* name = slot.regions[i].name;
+		auto found = historyIndex.find(name);
+		if (found == historyIndex.end()) {
+			found = historyIndex.emplace(name, histories.size()).first;
+			histories.push_back({ name });
+		}
+		history& h = histories[found->second];
+		if (h.samples.size() < historySize) {
+			h.samples.push_back(ms);
+		}
+		else {
+			h.samples[h.next] = ms;
+		}
+		h.next = (h.next + 1) % historySize;
+		h.lastMs = ms;
+
+		if (traceOrigin == 0) {
+			traceOrigin = start;
+		}
+		events.push_back({ name, double((start - traceOrigin) & validMask) * periodNs * 1e-3, ms * 1e3 });
+	}
+
+	trace.push_back(std::move(events));
+	if (trace.size() > traceFrames) {
+		trace.pop_front();
+	}
+}
+
+std::vector<gpuProfiler::regionStats> gpuProfiler::stats() const {
+	std::vector<regionStats> out;
+	out.reserve(histories.size());
+
+	for (const auto& h : histories) {
+		regionStats s{ .name = h.name, .lastMs = h.lastMs, .samples = static_cast<uint32_t>(h.samples.size()) };
+		if (!h.samples.empty()) {
+			std::vector<double> sorted = h.samples;
+			std::sort(sorted.begin(), sorted.end());
+			s.minMs = sorted.front();
+			double sum = 0.0;
+			for (double v : sorted) {
+				sum += v;
+			}
+			s.avgMs = sum / sorted.size();
+			s.p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+		}
+		out.push_back(s);
+	}
+	return out;
+}
+
+bool gpuProfiler::writeChromeTrace(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+
+	// microseconds since the first event; the default six significant digits lose precision after a second
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (const auto& frame : trace) {
+		for (const auto& event : frame) {
+			file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":\"gpu\",\"ts\":"
+				<< event.startUs << ",\"dur\":" << event.durationUs << "}";
+			first = false;
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,179 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "hotreload.h"
+#include "log.h"
+#include "cpuprofiler.h"
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const auto pollInterval = std::chrono::milliseconds(250);
+
+	std::filesystem::file_time_type modified(const std::string& path) {
+		std::error_code ec;
+		auto mtime = std::filesystem::last_write_time(path, ec);
+		return ec ? std::filesystem::file_time_type() : mtime;
+	}
+
+	std::string directoryOf(const std::string& path) {
+		std::string dir = std::filesystem::path(path).parent_path().string();
+		return dir.empty() ? "." : dir;
+	}
+}
+
+fileWatcher::~fileWatcher() {
+	close();
+}
+
+bool fileWatcher::watch(const std::string& path) {
+	files.push_back({ path, modified(path) });
+
+#ifdef __linux__
+	if (inotifyFd < 0) {
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	}
+	if (inotifyFd >= 0) {
+		std::string dir = directoryOf(path);
+		bool known = std::any_of(directories.begin(), directories.end(), [&](const auto& item) {
+			return item.second == dir;
+		});
+		if (!known) {
+			int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (wd < 0) {
+				return false;
+			}
+			directories[wd] = dir;
+		}
+	}
+#endif
+	return true;
+}
+
+std::vector<std::string> fileWatcher::poll() {
+	std::vector<std::string> changed;
+
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			ssize_t size = read(inotifyFd, buffer, sizeof(buffer));
+			if (size <= 0) {
+				break;
+			}
+			for (char* at = buffer; at < buffer + size;) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+				at += sizeof(inotify_event) + event->len;
+
+				auto dir = directories.find(event->wd);
+				if (dir == directories.end() || event->len == 0) {
+					continue;
+				}
+				std::filesystem::path written = std::filesystem::path(dir->second) / event->name;
+				for (auto& file : files) {
+					if (std::filesystem::path(file.path).lexically_normal() == written.lexically_normal()
+						&& std::find(changed.begin(), changed.end(), file.path) == changed.end()) {
+						changed.push_back(file.path);
+					}
+				}
+			}
+		}
+		return changed;
+	}
+#endif
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastScan < pollInterval) {
+		return changed;
+	}
+	lastScan = now;
+
+	for (auto& file : files) {
+		auto mtime = modified(file.path);
+		if (mtime != file.mtime) {
+			file.mtime = mtime;
+			changed.push_back(file.path);
+		}
+	}
+	return changed;
+}
+
+void fileWatcher::close() {
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		::close(inotifyFd);
+		inotifyFd = -1;
+	}
+	directories.clear();
+#endif
+	files.clear();
+}
+
+void shaderHotReload::init(pipelineManager& pipelineSet, const std::vector<shaderSource>& shaderSources,
+	const std::string& shaderCompiler) {
+	pipelines = &pipelineSet;
+	sources = shaderSources;
+	compiler = shaderCompiler;
+	compileThread = std::make_unique<threadPool>(1);
+
+	for (const auto& source : sources) {
+		watcher.watch(source.glsl);
+		watcher.watch(source.spv);
+		// lands like any other rebuild, so whoever wants the module picks it up then
+		std::error_code ec;
+		if (!std::filesystem::exists(source.spv, ec) && std::filesystem::exists(source.glsl, ec)) {
+			pending.push_back(compileThread->submit([this, source]() { compile(source); }));
+		}
+	}
+
+	LOG_INFO("shader hot reload watching " << sources.size() << " shaders");
+}
+
+void shaderHotReload::destroy() {
+	compileThread.reset();
+	pending.clear();
+	watcher.close();
+}
+
+std::vector<std::string> shaderHotReload::update() {
+	std::vector<std::string> rebuilt;
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [](std::future<void>& job) {
+		return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}), pending.end());
+
+	for (const auto& path : watcher.poll()) {
+		for (const auto& source : sources) {
+			if (path == source.glsl) {
+				pending.push_back(compileThread->submit([this, source]() { compile(source); }));
+			}
+			else if (path == source.spv) {
+				size_t count = pipelines->reload(source.spv);
+				LOG_INFO(source.spv << " changed, rebuilding " << count << " pipelines");
+				rebuilt.push_back(source.spv);
+			}
+		}
+	}
+	return rebuilt;
+}
+
+void shaderHotReload::compile(const shaderSource& source) {
+	CPU_ZONE("compile shader");
+	// compile beside the target and rename, so the watcher never sees a half-written module
+	std::string tmp = source.spv + ".tmp";
+	std::string command = compiler + " \"" + source.glsl + "\" -o \"" + tmp + "\"";
+
+	if (std::system(command.c_str()) != 0) {
+		LOG_WARN("shader compile failed: " << source.glsl);
+		return;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp, source.spv, ec);
+	if (ec) {
+		LOG_WARN("shader compile could not replace " << source.spv);
+	}
+}
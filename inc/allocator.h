@@ -0,0 +1,135 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "tlsf.h"
+
+// source of raw device memory objects
+//
+// the Vulkan backend forwards to vkAllocateMemory; a fake one handing out made-up handles lets the
+// sub-allocator run on the CPU without a device
+struct memoryBackend {
+	virtual ~memoryBackend() = default;
+	virtual const vk::PhysicalDeviceMemoryProperties& properties() const = 0;
+	// returns a null handle when the heap is exhausted
+	virtual vk::DeviceMemory allocate(uint32_t memoryType, vk::DeviceSize size,
+		vk::Buffer dedicatedBuffer, vk::Image dedicatedImage) = 0;
+	virtual void free(vk::DeviceMemory memory) = 0;
+	virtual void* map(vk::DeviceMemory memory, vk::DeviceSize size) = 0;
+};
+
+// made-up memory objects over host memory, for driving the allocator without a device: type 0 is
+// device-local on heap 0, type 1 host-visible and coherent on heap 1
+struct fakeMemoryBackend : memoryBackend {
+	void init(vk::DeviceSize deviceHeapSize, vk::DeviceSize hostHeapSize);
+
+	const vk::PhysicalDeviceMemoryProperties& properties() const override {
+		return memProperties;
+	}
+	vk::DeviceMemory allocate(uint32_t memoryType, vk::DeviceSize size,
+		vk::Buffer dedicatedBuffer, vk::Image dedicatedImage) override;
+	void free(vk::DeviceMemory memory) override;
+	void* map(vk::DeviceMemory memory, vk::DeviceSize size) override;
+
+	uint32_t liveCount() const {
+		return static_cast<uint32_t>(objects.size());
+	}
+
+private:
+	struct object {
+		uint32_t memoryType;
+		vk::DeviceSize size;
+		std::unique_ptr<uint8_t[]> host;
+	};
+
+	vk::PhysicalDeviceMemoryProperties memProperties;
+	std::unordered_map<VkDeviceMemory, object> objects;
+	std::vector<vk::DeviceSize> heapUsed;
+	uintptr_t nextHandle = 1;
+};
+
+struct vulkanMemoryBackend : memoryBackend {
+	void init(vk::Device device, vk::PhysicalDevice gpu);
+
+	const vk::PhysicalDeviceMemoryProperties& properties() const override {
+		return memProperties;
+	}
+	vk::DeviceMemory allocate(uint32_t memoryType, vk::DeviceSize size,
+		vk::Buffer dedicatedBuffer, vk::Image dedicatedImage) override;
+	void free(vk::DeviceMemory memory) override;
+	void* map(vk::DeviceMemory memory, vk::DeviceSize size) override;
+
+private:
+	vk::Device device;
+	vk::PhysicalDeviceMemoryProperties memProperties;
+};
+
+// buffers and linear images never share a block with optimal-tiling images, which keeps every
+// block free of bufferImageGranularity conflicts without per-neighbour padding
+enum class resourceKind : uint32_t {
+	linear,
+	optimal
+};
+
+struct allocation {
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset = 0;
+	vk::DeviceSize size = 0;
+	void* mapped = nullptr;
+	uint32_t memoryType = 0;
+	uint32_t block = UINT32_MAX;	// UINT32_MAX for dedicated allocations
+	uint32_t node = UINT32_MAX;
+};
+
+struct heapStats {
+	vk::DeviceSize heapSize = 0;
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t allocationCount = 0;
+	vk::DeviceSize blockBytes = 0;		// reserved in shared blocks
+	vk::DeviceSize usedBytes = 0;		// handed out from shared blocks
+	vk::DeviceSize dedicatedBytes = 0;
+};
+
+// carves resources out of large per-memory-type blocks
+struct gpuAllocator {
+	static const vk::DeviceSize defaultBlockSize = 128ull * 1024 * 1024;
+
+	void init(memoryBackend* backend, vk::DeviceSize blockSize = defaultBlockSize);
+	void destroy();
+
+	// picks the first memory type allowed by req that has all required flags; dedicated asks for a
+	// private memory object (large images, or when the driver reports it prefers one)
+	bool allocate(const vk::MemoryRequirements& req, vk::MemoryPropertyFlags required, resourceKind kind,
+		bool dedicated, allocation& out, vk::Buffer dedicatedBuffer = nullptr, vk::Image dedicatedImage = nullptr);
+	void free(allocation& a);
+
+	heapStats stats(uint32_t heap) const;
+	uint32_t heapCount() const;
+
+private:
+	struct block {
+		vk::DeviceMemory memory;
+		uint8_t* mapped = nullptr;
+		uint32_t memoryType = 0;
+		resourceKind kind = resourceKind::linear;
+		std::unique_ptr<tlsf> ranges;
+	};
+
+	bool allocateFrom(uint32_t memoryType, const vk::MemoryRequirements& req, resourceKind kind, allocation& out);
+	bool allocateDedicated(uint32_t memoryType, const vk::MemoryRequirements& req, allocation& out,
+		vk::Buffer dedicatedBuffer, vk::Image dedicatedImage);
+	vk::DeviceSize blockSizeFor(uint32_t memoryType) const;
+	bool hostVisible(uint32_t memoryType) const;
+
+	memoryBackend* backend = nullptr;
+	vk::DeviceSize preferredBlockSize = defaultBlockSize;
+	std::vector<block> blocks;
+	std::vector<uint32_t> freeBlockSlots;
+	std::vector<heapStats> dedicatedStats;
+};
+
+// drives tlsf and gpuAllocator over fakeMemoryBackend on the CPU and logs every check that fails
+bool allocatorSelfTest();
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// set to 0 to compile every CPU_ZONE/CPU_FRAME away
+#ifndef R2E_CPU_PROFILE
+#define R2E_CPU_PROFILE 1
+#endif
+
+// scoped CPU timings written to per-thread rings and gathered once per frame
+//
+// each thread owns a single-producer ring; a zone is two timestamp reads and one store on the
+// recording thread, with no locks and no shared cache lines. the thread calling frameMark() is the
+// only consumer: it drains every ring, attributes the events to the frame that just ended and keeps
+// the last traceFrames frames for export
+struct cpuProfiler {
+	struct zoneStats {
+		std::string name;
+		double lastMs = 0.0;	// summed over all calls and threads in the last frame
+		double avgMs = 0.0;
+		double maxMs = 0.0;
+		uint32_t lastCalls = 0;
+		uint32_t samples = 0;
+	};
+
+	static constexpr uint32_t ringSize = 8192;		// events per thread between two frameMark calls
+	static constexpr uint32_t historySize = 256;	// frames kept per zone
+	static constexpr uint32_t traceFrames = 120;	// frames kept for the Chrome trace
+
+	// invariant TSC on x86-64, converted to wall time against steady_clock as frames are collected
+	static uint64_t now() {
+#if defined(_M_X64) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	cpuProfiler();
+	cpuProfiler(const cpuProfiler&) = delete;
+	cpuProfiler& operator=(const cpuProfiler&) = delete;
+
+	// name must outlive the profiler, a string literal in practice
+	void record(const char* name, uint64_t start, uint64_t end);
+	// labels the calling thread in the trace; optional
+	void setThreadName(const std::string& name);
+
+	// ends the current frame; call from one thread only, the render loop's
+	void frameMark();
+
+	std::vector<zoneStats> stats() const;
+	uint64_t dropped() const;
+	// chrome://tracing or Perfetto JSON of the last traceFrames frames
+	bool writeChromeTrace(const std::string& path) const;
+
+private:
+	struct event {
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	struct threadRing {
+		// producer and consumer indices on separate lines; the producer caches the consumer's
+		alignas(64) std::atomic<uint64_t> head{ 0 };
+		uint64_t cachedTail = 0;
+		alignas(64) std::atomic<uint64_t> tail{ 0 };
+		std::atomic<uint64_t> dropped{ 0 };
+		uint32_t index = 0;
+		std::string name;
+		event events[ringSize];
+	};
+
+	struct traceEvent {
+		const char* name;
+		uint32_t thread;
+		double startUs;
+		double durationUs;
+	};
+
+	struct history {
+		std::string name;
+		std::vector<double> samples;
+		uint32_t next = 0;
+		double lastMs = 0.0;
+		uint32_t lastCalls = 0;
+		// accumulated while frameMark() drains the rings
+		double frameMs = 0.0;
+		uint32_t frameCalls = 0;
+	};
+
+	threadRing* registerThread();
+	double ticksToUs(uint64_t ticks) const;
+
+	mutable std::mutex ringMutex;
+	std::vector<std::unique_ptr<threadRing>> rings;
+
+	// tick calibration, refreshed on every frameMark
+	uint64_t originTicks = 0;
+	std::chrono::steady_clock::time_point originTime;
+	double usPerTick = 0.0;
+	uint64_t lastFrameTicks = 0;
+
+	// frameMark() runs every frame in production builds, so once every zone has been seen and the
+	// trace ring is full it allocates nothing: zones are looked up by their literal's address and the
+	// oldest trace frame's storage is reused for the next
+	std::vector<history> histories;
+	std::unordered_map<const char*, size_t> historyIndex;
+	std::vector<size_t> frameZones;		// histories touched this frame, in the order first seen
+	std::vector<std::vector<traceEvent>> trace;		// ring of traceFrames frames
+	uint32_t traceNext = 0;
+	uint32_t traceCount = 0;
+	std::vector<traceEvent> pending;
+};
+
+extern cpuProfiler cpuProfile;
+
+struct cpuZone {
+	explicit cpuZone(const char* name) : name(name), start(cpuProfiler::now()) {
+	}
+	~cpuZone() {
+		cpuProfile.record(name, start, cpuProfiler::now());
+	}
+	cpuZone(const cpuZone&) = delete;
+	cpuZone& operator=(const cpuZone&) = delete;
+
+private:
+	const char* name;
+	uint64_t start;
+};
+
+#define CPU_CONCAT_INNER(a, b) a##b
+#define CPU_CONCAT(a, b) CPU_CONCAT_INNER(a, b)
+
+#if R2E_CPU_PROFILE
+#define CPU_ZONE(name) cpuZone CPU_CONCAT(cpuZone_, __LINE__)(name)
+#define CPU_FRAME() cpuProfile.frameMark()
+#else
+#define CPU_ZONE(name) ((void)0)
+#define CPU_FRAME() ((void)0)
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// frustum culling of many objects at once
+//
+// bounds live in structure-of-arrays form so one SIMD load fetches the same coordinate of 4 or 8
+// objects; the arrays are padded to whole 8-wide batches with bounds that never pass, so no path
+// needs a scalar tail
+struct cullBounds {
+	static const uint32_t batch = 8;
+
+	// axis-aligned boxes as centre and half extents
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	uint32_t count = 0;
+
+	// returns the object's index; a sphere goes in as its bounding cube
+	uint32_t add(glm::vec3 center, glm::vec3 extent);
+	void set(uint32_t index, glm::vec3 center, glm::vec3 extent);
+	void clear();
+};
+
+enum class cullPath {
+	scalar,
+	sse,	// 4 objects per step; every x86-64 CPU has SSE2
+	avx2	// 8 objects per step
+};
+
+// the widest path this CPU and build support
+cullPath bestCullPath();
+const char* to_string(cullPath path);
+
+// writes the indices of the objects inside all six planes (inward normals, as meshletCullView
+// extracts them) to the front of visible in ascending order and returns how many there are. visible
+// grows to hold every object but never shrinks, so one list serves every frame. paths this CPU lacks
+// fall back to the next narrower one
+uint32_t cullFrustum(const cullBounds& bounds, const glm::vec4 (&planes)[6], std::vector<uint32_t>& visible,
+	cullPath path = bestCullPath());
+
+// culls objectCount random boxes on every available path and logs the time per pass
+void benchmarkCulling(uint32_t objectCount, uint32_t iterations);
@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// one indexed draw; buffers are bound only when they differ from the previous draw's
+struct drawItem {
+	// a draw without a pipeline is skipped; pipelineId, when set, is resolved to pipeline each frame
+	vk::Pipeline pipeline;
+	uint32_t pipelineId = UINT32_MAX;
+	vk::Buffer vertexBuffer;
+	vk::DeviceSize vertexBufferOffset = 0;
+	vk::Buffer indexBuffer;
+	vk::DeviceSize indexBufferOffset = 0;
+	vk::IndexType indexType = vk::IndexType::eUint32;
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+	// vertex-stage push constants, pushed when they or the layout differ from the previous draw's;
+	// the data must outlive the draw list
+	vk::PipelineLayout layout;
+	const void* pushConstants = nullptr;
+	uint32_t pushConstantSize = 0;
+	// when set, draws indirectCount DrawIndexedIndirectCommands from here instead of the counts above;
+	// a count of 0 draws nothing
+	vk::Buffer indirectBuffer;
+	vk::DeviceSize indirectOffset = 0;
+	uint32_t indirectCount = 0;
+};
+
+// draws recorded into the main render pass every frame
+//
+// the renderer re-records its command buffers from scratch each frame, so anything the engine changes
+// here between frames shows up on the next one; custom work goes through recorders, which run after
+// the draws inside the same render pass
+struct drawList {
+	using recorder = std::function<void(vk::CommandBuffer cmd)>;
+
+	std::vector<drawItem> draws;
+	std::vector<recorder> recorders;
+	// without the multiDrawIndirect feature, indirect draws are issued one command at a time
+	bool multiDrawIndirect = true;
+
+	void add(const drawItem& item) {
+		draws.push_back(item);
+	}
+
+	void addRecorder(recorder fn) {
+		recorders.push_back(std::move(fn));
+	}
+
+	void clear() {
+		draws.clear();
+		recorders.clear();
+	}
+
+	void record(vk::CommandBuffer cmd) const;
+	// draws [first, first + count) only; parallel recording splits the list with this
+	void recordDraws(vk::CommandBuffer cmd, size_t first, size_t count) const;
+	void recordCustom(vk::CommandBuffer cmd) const;
+};
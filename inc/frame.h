@@ -0,0 +1,39 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include "allocator.h"
+
+// per-frame bump allocator over a host-visible buffer, rewound once the frame has completed
+struct transientBuffer {
+	vk::Buffer buffer;
+	allocation memory;
+	vk::DeviceSize head = 0;
+
+	// returns false when the frame has used up its transient space
+	bool allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset, void*& data) {
+		vk::DeviceSize aligned = (head + alignment - 1) / alignment * alignment;
+		if (aligned + size > memory.size) {
+			return false;
+		}
+		offset = aligned;
+		data = static_cast<uint8_t*>(memory.mapped) + aligned;
+		head = aligned + size;
+		return true;
+	}
+
+	void reset() {
+		head = 0;
+	}
+};
+
+// everything one frame in flight records into; reusable once the frame timeline reaches submitted
+struct frameContext {
+	uint64_t submitted = 0;
+	vk::Semaphore acquired;
+	vk::CommandPool pool;
+	vk::CommandBuffer cmd;
+	// one pool per recording slot, so parallel recording never shares a pool between threads
+	std::vector<vk::CommandPool> workerPools;
+	std::vector<vk::CommandBuffer> secondaries;
+	transientBuffer transient;
+};
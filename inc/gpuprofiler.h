@@ -0,0 +1,110 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GPU timestamps around named regions of a frame's command buffers
+//
+// every frame in flight owns a slice of one timestamp query pool; a slice is read back when its frame
+// context is reused, i.e. after the renderer has already waited for that frame, so resolving never
+// stalls. regions may be opened from worker threads recording secondary command buffers
+struct gpuProfiler {
+	struct regionStats {
+		std::string name;
+		double lastMs = 0.0;
+		double minMs = 0.0;
+		double avgMs = 0.0;
+		double p99Ms = 0.0;
+		uint32_t samples = 0;
+	};
+
+	static constexpr uint32_t maxRegions = 128;		// per frame
+	static constexpr uint32_t historySize = 256;	// samples kept per region
+	static constexpr uint32_t traceFrames = 120;	// frames kept for the Chrome trace
+
+	void init(vk::Device device, vk::PhysicalDevice gpu, uint32_t queueFamily, uint32_t framesInFlight);
+	void destroy();
+
+	bool enabled() const {
+		return pool != vk::QueryPool();
+	}
+
+	// first thing recorded into a frame's primary command buffer, outside any render pass
+	void beginFrame(vk::CommandBuffer cmd, uint32_t slotIndex);
+	// after the command buffer beginFrame recorded into reaches the queue; a slot re-recorded without
+	// being submitted is never read back, as its queries were never reset
+	void submitted(uint32_t slotIndex);
+	// name must outlive the profiler, a string literal in practice; returns a region for end()
+	uint32_t begin(vk::CommandBuffer cmd, const char* name, vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eTopOfPipe);
+	void end(vk::CommandBuffer cmd, uint32_t region, vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eBottomOfPipe);
+
+	// rolling statistics over the last historySize frames, in first-seen order
+	std::vector<regionStats> stats() const;
+	// chrome://tracing or Perfetto JSON of the last traceFrames resolved frames
+	bool writeChromeTrace(const std::string& path) const;
+
+private:
+	static constexpr uint32_t noRegion = UINT32_MAX;
+
+	struct region {
+		const char* name;
+	};
+
+	struct frameSlot {
+		std::array<region, maxRegions> regions;
+		// regions written by the last recording, resolved when the slot is reused
+		std::atomic<uint32_t> regionCount{ 0 };
+		bool submitted = false;
+	};
+
+	struct history {
+		std::string name;
+		std::vector<double> samples;
+		uint32_t next = 0;
+		double lastMs = 0.0;
+	};
+
+	struct traceEvent {
+		const char* name;
+		double startUs;
+		double durationUs;
+	};
+
+	void resolve(uint32_t slotIndex);
+
+	vk::Device device;
+	vk::QueryPool pool;
+	double periodNs = 1.0;
+	uint64_t validMask = ~0ull;
+	uint32_t currentSlot = 0;
+	std::unique_ptr<frameSlot[]> slots;
+	uint32_t slotCount = 0;
+
+	std::vector<history> histories;
+	std::unordered_map<std::string, size_t> historyIndex;
+	std::deque<std::vector<traceEvent>> trace;
+	uint64_t traceOrigin = 0;
+};
+
+// brackets the commands recorded during its lifetime
+struct gpuScope {
+	gpuScope(gpuProfiler& profiler, vk::CommandBuffer cmd, const char* name)
+		: profiler(profiler), cmd(cmd), region(profiler.begin(cmd, name)) {
+	}
+	~gpuScope() {
+		profiler.end(cmd, region);
+	}
+	gpuScope(const gpuScope&) = delete;
+	gpuScope& operator=(const gpuScope&) = delete;
+
+private:
+	gpuProfiler& profiler;
+	vk::CommandBuffer cmd;
+	uint32_t region;
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pipelines.h"
+#include "threadpool.h"
+
+// reports files that were written since the last poll; never blocks
+//
+// Linux uses inotify on the files' directories, which also catches editors that save by renaming a
+// temporary over the original; elsewhere modification times are polled a few times a second
+struct fileWatcher {
+	fileWatcher() = default;
+	fileWatcher(const fileWatcher&) = delete;
+	fileWatcher& operator=(const fileWatcher&) = delete;
+	~fileWatcher();
+
+	bool watch(const std::string& path);
+	std::vector<std::string> poll();
+	void close();
+
+private:
+	struct watchedFile {
+		std::string path;
+		std::filesystem::file_time_type mtime;
+	};
+	std::vector<watchedFile> files;
+	std::chrono::steady_clock::time_point lastScan;
+#ifdef __linux__
+	int inotifyFd = -1;
+	std::unordered_map<int, std::string> directories;
+#endif
+};
+
+// a GLSL source and the SPIR-V file pipelines load it from
+struct shaderSource {
+	std::string glsl;
+	std::string spv;
+};
+
+// watches shader sources and their SPIR-V; edited GLSL is recompiled with glslc in the background,
+// and any changed SPIR-V (ours or from an external build) recompiles the pipelines that use it.
+// pipelines are only swapped when the renderer calls pipelineManager::swapReloaded at a frame boundary.
+// a source whose SPIR-V does not exist yet is compiled once at startup
+struct shaderHotReload {
+	void init(pipelineManager& pipelines, const std::vector<shaderSource>& sources, const std::string& compiler = "glslc");
+	void destroy();
+
+	// once per frame; returns the SPIR-V files that changed
+	std::vector<std::string> update();
+
+private:
+	void compile(const shaderSource& source);
+
+	pipelineManager* pipelines = nullptr;
+	std::string compiler;
+	std::vector<shaderSource> sources;
+	fileWatcher watcher;
+	std::unique_ptr<threadPool> compileThread;
+	std::vector<std::future<void>> pending;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include "mesh.h"
+
+// import-time LOD chains by quadric error edge collapse (Garland, Heckbert 1997), and their selection
+// by projected error at draw time
+
+// collapses edges of an indexed triangle list onto existing vertices until at most targetIndexCount
+// indices remain or no collapse stays under errorLimit; writes the result to dst (indexCount entries
+// of room) and returns its index count
+//
+// open borders and uv/normal seams only collapse along themselves, so neither tears; error receives
+// the largest collapse error, as an object-space distance
+size_t simplifyMesh(uint32_t* dst, const uint32_t* indices, size_t indexCount, const Vertex* vertices,
+	size_t vertexCount, size_t targetIndexCount, float errorLimit, float& error);
+
+// appends up to maxLevels - 1 levels per submesh to m.indices, each about half the previous level's
+// triangles, and fills m.lods and the submeshes' LOD ranges and bounds; a submesh stops early once
+// simplifying stops paying off
+void buildLods(mesh& m, uint32_t maxLevels = 6);
+
+// pixels one object-space unit covers around the submesh: the view's vertical scale on a viewport
+// viewportHeight pixels tall, divided by the distance to the submesh's bounds when eye is given
+// (perspective); orthographic views pass no eye
+float lodPixelsPerUnit(const glm::mat4& viewProj, float viewportHeight, const submesh& part, const glm::vec3* eye);
+
+// the coarsest level whose error stays within threshold pixels; moving to a coarser level than current
+// needs the error to fit within threshold * (1 - hysteresis), so levels do not flicker at the boundary
+uint32_t selectLod(const meshLod* levels, uint32_t levelCount, uint32_t current, float pixelsPerUnit,
+	float threshold, float hysteresis);
@@ -0,0 +1,181 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum class logLevel : uint8_t {
+	trace,
+	debug,
+	info,
+	warn,
+	error,
+	off
+};
+
+// messages below this level are compiled out entirely; 0 = trace ... 4 = error
+#ifndef R2E_LOG_LEVEL
+#define R2E_LOG_LEVEL 1
+#endif
+
+// one message, formatted on the caller's thread into a fixed buffer; longer text is truncated
+struct logLine {
+	static constexpr uint32_t capacity = 232;
+
+	explicit logLine(logLevel level) : level(level) {
+	}
+
+	logLine& operator<<(std::string_view text) {
+		append(text.data(), text.size());
+		return *this;
+	}
+	logLine& operator<<(const char* text) {
+		return *this << std::string_view(text ? text : "(null)");
+	}
+	logLine& operator<<(const std::string& text) {
+		return *this << std::string_view(text);
+	}
+	logLine& operator<<(char c) {
+		append(&c, 1);
+		return *this;
+	}
+	logLine& operator<<(bool value) {
+		return *this << (value ? "true" : "false");
+	}
+
+	template<typename T>
+	logLine& operator<<(const T& value) {
+		if constexpr (std::is_integral_v<T>) {
+			char digits[24];
+			auto result = std::to_chars(digits, digits + sizeof(digits), value);
+			append(digits, result.ptr - digits);
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			// six significant digits, as std::ostream prints them
+			char digits[32];
+			auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+			append(digits, result.ptr - digits);
+		}
+		else if constexpr (std::is_enum_v<T>) {
+			return *this << static_cast<std::underlying_type_t<T>>(value);
+		}
+		else {
+			// anything else that can be streamed; allocates, so keep it off hot paths
+			std::ostringstream stream;
+			stream << value;
+			*this << stream.str();
+		}
+		return *this;
+	}
+
+	logLevel level;
+	uint32_t length = 0;
+	bool truncated = false;
+	char text[capacity];
+
+private:
+	void append(const char* data, size_t size) {
+		if (size > capacity - length) {
+			size = capacity - length;
+			truncated = true;
+		}
+		std::char_traits<char>::copy(text + length, data, size);
+		length += static_cast<uint32_t>(size);
+	}
+};
+
+// asynchronous logger: callers push records into a bounded lock-free queue and a background thread
+// formats and writes them, flushing once per batch rather than once per line
+//
+// logging never blocks; when the writer falls a full queue behind, records are dropped and counted.
+// before init() and after shutdown() messages are written synchronously
+struct logger {
+	enum class format {
+		text,	// [  1.234567] info  t0  swapchain created
+		json	// one object per line: {"t":1.234567,"level":"info","thread":0,"msg":"swapchain created"}
+	};
+
+	static constexpr uint32_t queueSize = 4096;
+
+	logger();
+	~logger();
+	logger(const logger&) = delete;
+	logger& operator=(const logger&) = delete;
+
+	void init(format outputFormat = format::text);
+	// drains everything still queued, then stops the writer
+	void shutdown();
+
+	bool enabled(logLevel level) const {
+		return level >= minLevel.load(std::memory_order_relaxed);
+	}
+	void setLevel(logLevel level) {
+		minLevel.store(level, std::memory_order_relaxed);
+	}
+
+	void push(const logLine& line);
+
+	uint64_t dropped() const {
+		return droppedCount.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct record {
+		uint64_t timeNs;
+		uint32_t thread;
+		uint32_t length;
+		logLevel level;
+		bool truncated;
+		char text[logLine::capacity];
+	};
+
+	struct slot {
+		std::atomic<uint64_t> sequence;
+		record item;
+	};
+
+	void writerLoop();
+	void write(const record& item);
+	static void fill(record& item, const logLine& line, uint64_t timeNs);
+
+	std::chrono::steady_clock::time_point origin;
+	std::atomic<logLevel> minLevel{ logLevel::info };
+	format outputFormat = format::text;
+	std::unique_ptr<slot[]> slots;
+
+	// Vyukov's bounded queue: many producers, the writer thread as the single consumer
+	alignas(64) std::atomic<uint64_t> enqueuePos{ 0 };
+	alignas(64) uint64_t dequeuePos = 0;
+	alignas(64) std::atomic<uint32_t> pushed{ 0 };
+	std::atomic<bool> writerSleeping{ false };
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> droppedCount{ 0 };
+	std::thread writer;
+};
+
+extern logger engineLog;
+
+const char* to_string(logLevel level);
+// "trace", "debug", "info", "warn", "error" or "off"; false for anything else
+bool parseLogLevel(std::string_view name, logLevel& level);
+
+#define LOG_AT(level, message) \
+	do { \
+		if (static_cast<int>(level) >= R2E_LOG_LEVEL && engineLog.enabled(level)) { \
+			logLine logLine_(level); \
+			logLine_ << message; \
+			engineLog.push(logLine_); \
+		} \
+	} while (0)
+
+#define LOG_TRACE(message) LOG_AT(logLevel::trace, message)
+#define LOG_DEBUG(message) LOG_AT(logLevel::debug, message)
+#define LOG_INFO(message) LOG_AT(logLevel::info, message)
+#define LOG_WARN(message) LOG_AT(logLevel::warn, message)
+#define LOG_ERROR(message) LOG_AT(logLevel::error, message)
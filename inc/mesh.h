@@ -0,0 +1,116 @@
+#pragma once
+#ifndef GLM_ENABLE_EXPERIMENTAL
+#define GLM_ENABLE_EXPERIMENTAL
+#endif
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace tinyobj {
+	struct attrib_t;
+	struct shape_t;
+}
+
+struct Vertex {
+	glm::vec3 pos;
+	glm::vec3 normal;
+	glm::vec2 texCoord;
+
+	bool operator==(const Vertex& other) const {
+		return pos == other.pos && normal == other.normal && texCoord == other.texCoord;
+	}
+};
+
+namespace std {
+	template<> struct hash<Vertex> {
+		size_t operator()(const Vertex& vertex) const {
+			return ((hash<glm::vec3>()(vertex.pos) ^
+				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
+				(hash<glm::vec2>()(vertex.texCoord) << 1);
+		}
+	};
+}
+
+// contiguous index range sharing one OBJ object and material
+struct submesh {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t materialId;
+	uint32_t nameOffset;
+	uint32_t firstMeshlet = 0;
+	uint32_t meshletCount = 0;
+	// lods[firstLod] is the full-detail range above, each later level coarser
+	uint32_t firstLod = 0;
+	uint32_t lodCount = 0;
+	// bounding sphere of the full-detail triangles
+	glm::vec3 center{ 0.0f };
+	float radius = 0.0f;
+};
+
+// one level of a submesh's LOD chain: an index range over the same vertices as the full-detail triangles
+struct meshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	// how far, in object space, the level may stray from the full-detail surface
+	float error;
+};
+
+// contiguous run of a submesh's triangles with the bounds needed to cull it as a whole; cull.comp reads
+// the same 48 bytes as a std430 struct, so the layout is fixed
+struct meshlet {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount;	// distinct vertices referenced
+	uint32_t submesh;
+	glm::vec3 center{ 0.0f };
+	float radius = 0.0f;
+	// coneAxis points out of the front faces; every triangle faces away from an eye e when
+	// dot(center - e, coneAxis) >= coneCutoff * |center - e| + radius. a cutoff of 1 never culls
+	glm::vec3 coneAxis{ 0.0f, 0.0f, 1.0f };
+	float coneCutoff = 1.0f;
+};
+
+// non-owning view of upload-ready geometry, backed by a mesh or a mapped cache file
+struct meshView {
+	const Vertex* vertices = nullptr;
+	uint32_t vertexCount = 0;
+	const void* indices = nullptr;
+	uint32_t indexCount = 0;
+	uint32_t indexSize = 0;
+	const submesh* submeshes = nullptr;
+	uint32_t submeshCount = 0;
+	const meshlet* meshlets = nullptr;
+	uint32_t meshletCount = 0;
+	const meshLod* lods = nullptr;
+	uint32_t lodCount = 0;
+};
+
+// unique vertex table plus triangle list indexing into it
+struct mesh {
+	std::vector<Vertex> vertices;
+	// the submeshes' full-detail ranges, then the coarser LOD levels from buildLods
+	std::vector<uint32_t> indices;
+	std::vector<submesh> submeshes;
+	// empty until buildMeshlets
+	std::vector<meshlet> meshlets;
+	// empty until buildLods
+	std::vector<meshLod> lods;
+	// zero-separated submesh names, indexed by submesh::nameOffset
+	std::vector<char> names;
+
+	// 16-bit indices are enough while every vertex is addressable by them
+	bool compactIndices() const {
+		return vertices.size() <= UINT16_MAX;
+	}
+
+	meshView view() const {
+		return { vertices.data(), static_cast<uint32_t>(vertices.size()),
+			indices.data(), static_cast<uint32_t>(indices.size()), sizeof(uint32_t),
+			submeshes.data(), static_cast<uint32_t>(submeshes.size()),
+			meshlets.data(), static_cast<uint32_t>(meshlets.size()),
+			lods.data(), static_cast<uint32_t>(lods.size()) };
+	}
+};
+
+mesh buildMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes);
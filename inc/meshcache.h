@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "mesh.h"
+#include "util.h"
+
+// binary mesh cache (.r2em) written next to the source OBJ
+//
+// layout: header | vertex blob | index blob | submesh table | submesh names | meshlet table | LOD table
+// every blob starts on a 16-byte boundary so it can be copied straight into a staging buffer
+
+const uint32_t meshCacheMagic = 0x4d453252; // "R2EM"
+// 2: triangles and vertices in optimized order, 3: meshlets, 4: LODs, 5: meshlet cones out of the front faces
+const uint32_t meshCacheVersion = 5;
+
+enum class vertexSemantic : uint32_t {
+	position,
+	normal,
+	texCoord
+};
+
+struct meshCacheAttribute {
+	vertexSemantic semantic;
+	uint32_t components;	// 32-bit floats
+	uint32_t offset;
+};
+
+struct meshCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;			// hash of source path, mtime and contents
+	uint32_t vertexStride;
+	uint32_t attributeCount;
+	meshCacheAttribute attributes[4];
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;
+	uint32_t submeshCount;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t submeshOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+	uint64_t meshletOffset;
+	uint32_t meshletCount;
+	uint32_t lodCount;
+	uint64_t lodOffset;
+};
+
+// mapped cache file; the view points into the mapping and lives as long as it does
+struct cachedMesh {
+	mappedFile file;
+	meshView view;
+	const char* names = nullptr;
+
+	const char* submeshName(const submesh& sm) const;
+};
+
+std::string meshCachePath(const std::string& sourcePath);
+bool loadMeshCache(const std::string& sourcePath, cachedMesh& out);
+bool writeMeshCache(const std::string& sourcePath, const mesh& m);
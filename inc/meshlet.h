@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include "mesh.h"
+
+// what meshlets are culled against, in the mesh's object space
+struct meshletCullView {
+	// normals point inwards; all-zero planes, from a projection that ignores depth, never cull
+	glm::vec4 planes[6];
+	glm::vec3 eye{ 0.0f };
+	// orthographic views look along forward instead of from eye
+	glm::vec3 forward{ 0.0f, 0.0f, 1.0f };
+	bool orthographic = false;
+
+	static meshletCullView fromPerspective(const glm::mat4& viewProj, glm::vec3 eye);
+	static meshletCullView fromOrthographic(const glm::mat4& viewProj, glm::vec3 forward);
+};
+
+// splits every submesh into meshlets of at most maxTriangles triangles, following the existing
+// triangle order so each meshlet is a contiguous index range of the shared index buffer
+//
+// winding follows the pipeline: a triangle faces the viewer when it is clockwise on screen, and the
+// cone axis points out of the front faces
+void buildMeshlets(mesh& m, uint32_t maxTriangles = 124);
+
+// frustum test on the bounding sphere, then the normal cone against the eye or view direction
+bool meshletVisible(const meshlet& ml, const meshletCullView& view);
+
+// builds small grids facing towards and away from the given orthographic view (the renderer's) and
+// from a perspective eye, and checks which meshlets survive; logs every check that fails
+bool meshletSelfTest(const glm::mat4& viewProj, glm::vec3 forward);
@@ -0,0 +1,71 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <vector>
+#include "frame.h"
+#include "meshlet.h"
+#include "reflect.h"
+#include "shaders.h"
+
+// what cull.comp copies into the commands of a submesh's meshlets; instanceCount 0 leaves all of them
+// empty, for submeshes out of view or drawn another way this frame
+struct meshletCullSubmesh {
+	int32_t vertexOffset;
+	uint32_t instanceCount;
+	uint32_t firstInstance;
+};
+
+// culls every meshlet of the model in one compute dispatch of shaders/cull.spv
+//
+// the meshlet table lives in a device-local buffer; the submesh states and the commands come from the
+// frame's transient buffer. meshlet i always writes command i, empty when culled, so each submesh is
+// one multi-draw over its own range and nothing has to be compacted or counted
+struct meshletCullPass {
+	static constexpr uint32_t groupSize = 64;	// local_size_x in cull.comp
+
+	// false when cull.spv is missing or does not have the interface below; meshlets are culled on the
+	// CPU then
+	bool init(vk::Device device, const vk::PhysicalDeviceLimits& limits, vk::PipelineCache cache, shaderRegistry& shaders,
+		layoutCache& layouts, uint32_t framesInFlight);
+	void destroy();
+
+	bool ready() const {
+		return pipeline != vk::Pipeline();
+	}
+
+	// takes this frame's submesh states and commands from transient and points the frame's descriptor
+	// set at them; the states come back zeroed. null when the frame is out of transient space
+	meshletCullSubmesh* begin(uint32_t slot, transientBuffer& transient, vk::Buffer meshlets, const meshletCullView& view,
+		uint32_t submeshCount, uint32_t meshletCount);
+	// where the command of meshlet index lands in the transient buffer
+	vk::DeviceSize commandOffset(uint32_t slot, uint32_t index) const;
+	// outside a render pass, before the draws that read the commands; records nothing when the slot's
+	// last begin failed
+	void record(vk::CommandBuffer cmd, uint32_t slot);
+
+	// meshlets the slot's last dispatch kept and their triangles, read from the commands once the frame
+	// has completed; false when the slot did not cull on the GPU
+	bool results(uint32_t slot, const transientBuffer& transient, uint32_t& visible, uint32_t& triangles) const;
+
+private:
+	// cull.comp's push constants
+	struct pushView {
+		glm::vec4 planes[6];
+		glm::vec4 viewer;	// w 1: orthographic view direction, w 0: eye
+		uint32_t meshletCount;
+	};
+
+	struct frameSlot {
+		vk::DescriptorSet set;
+		vk::DeviceSize commands = 0;
+		uint32_t meshletCount = 0;	// 0 when the slot's last begin failed
+		pushView view;
+	};
+
+	vk::Device device;
+	vk::DeviceSize storageAlignment = 1;
+	vk::DescriptorPool pool;
+	vk::PipelineLayout layout;	// owned by the layout cache
+	vk::Pipeline pipeline;
+	std::vector<frameSlot> slots;
+};
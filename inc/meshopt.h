@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "mesh.h"
+
+// ingest-time reordering of an indexed mesh for the post-transform cache, overdraw and vertex fetch
+//
+// none of these change what is drawn, only the order triangles and vertices are stored in
+
+// results of replaying an index buffer through a FIFO post-transform cache
+struct vertexCacheStats {
+	uint32_t misses = 0;
+	float acmr = 0.0f;		// misses per triangle: 0.5 is ideal for large regular meshes, 3 is worst
+	float atvr = 0.0f;		// misses per referenced vertex: 1 is ideal
+};
+
+vertexCacheStats simulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Tipsify (Sander, Nehab, Barczak 2007): linear time, tuned for a cache of cacheSize entries
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// splits a cache-optimized triangle order into clusters at points where that costs at most threshold
+// times the ACMR, then orders clusters so outward-facing ones far from the centre come first
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	float threshold = 1.05f, uint32_t cacheSize = 16);
+
+// renumbers vertices in first-use order so fetches walk the vertex buffer forwards; vertices no
+// index refers to are dropped. returns the new vertex count
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+struct meshOptimizeStats {
+	vertexCacheStats before;
+	vertexCacheStats after;
+};
+
+// all three passes; triangles are reordered within their submesh only, so submesh ranges hold
+meshOptimizeStats optimizeMesh(mesh& m);
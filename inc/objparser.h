@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "threadpool.h"
+
+namespace tinyobj {
+	struct attrib_t;
+	struct shape_t;
+	struct material_t;
+}
+
+// parallel drop-in for tinyobj::LoadObj on large assets
+//
+// the file is memory-mapped, split into line-aligned chunks parsed on the pool, and the
+// per-chunk results are stitched together with prefix sums. handles v/vt/vn/f/o/g/usemtl/
+// mtllib/s and produces triangulated shapes like LoadObj; lines, points, tags and vertex
+// weights are ignored, and polygons with more than four corners are fan-triangulated
+bool loadObjParallel(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+	std::vector<tinyobj::material_t>* materials, std::string* warn, std::string* err,
+	const char* filename, const char* mtlBasedir, threadPool& pool);
+
+// loads copies of filename concatenated into one file with tinyobj::LoadObj and with loadObjParallel,
+// logs both times and whether the results match
+void benchmarkObjLoading(const char* filename, const char* mtlBasedir, uint32_t copies, threadPool& pool);
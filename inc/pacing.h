@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <vector>
+
+// preferred presentation behaviour; falls back towards Fifo, which every device supports
+enum class presentPolicy {
+	mailbox,		// no tearing, newest frame wins
+	immediate,		// lowest latency, may tear
+	fifoRelaxed,	// vsync, tears only when a frame is late
+	fifo			// strict vsync
+};
+
+vk::PresentModeKHR choosePresentMode(const std::vector<vk::PresentModeKHR>& available, presentPolicy policy);
+
+// moving averages in milliseconds
+struct latencyStats {
+	double frameMs = 0.0;			// CPU frame interval
+	double sleepMs = 0.0;			// pacing sleep before sampling input
+	double gpuWaitMs = 0.0;			// blocked until the frame context was free
+	double acquireMs = 0.0;			// blocked in vkAcquireNextImageKHR
+	double presentMs = 0.0;			// inside vkQueuePresentKHR
+	double recordMs = 0.0;			// command buffer recording
+	double inputToSubmitMs = 0.0;
+	double inputToPresentMs = 0.0;
+};
+
+enum class paceStage {
+	gpuWait,
+	acquire,
+	present,
+	record
+};
+
+// just-in-time frame pacing
+//
+// time the render thread spends blocked on the GPU or the swapchain after input was sampled is pure
+// latency; the pacer moves it in front of input sampling instead, keeping only safetyMs of slack
+struct framePacer {
+	using clock = std::chrono::steady_clock;
+
+	bool enabled = true;
+	double targetFps = 0.0;		// optional cap, 0 follows the display
+	double safetyMs = 1.0;
+
+	// call right before polling input
+	void sleepUntilInput();
+	void inputSampled();
+	void record(paceStage stage, clock::duration elapsed);
+	void submitted();
+	void presented();
+
+	const latencyStats& stats() const {
+		return averages;
+	}
+
+private:
+	double sleepMs = 0.0;
+	double blockedMs = 0.0;
+	clock::time_point frameStart;
+	clock::time_point inputTime;
+	latencyStats current;
+	latencyStats averages;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// VkPipelineCache persisted between runs
+//
+// file layout: pipelineCacheFileHeader | driver blob. the driver blob is only handed back to the
+// driver when its VkPipelineCacheHeaderVersionOne matches this device and the checksum is intact;
+// some drivers crash on stale or corrupt data instead of rejecting it
+
+const uint32_t pipelineCacheMagic = 0x43503252; // "R2PC"
+const uint32_t pipelineCacheVersion = 1;
+
+struct pipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t dataSize;
+	uint64_t dataHash;
+};
+
+struct pipelineCacheStore {
+	// loads path if it is valid for gpu, otherwise starts empty
+	void init(vk::Device device, vk::PhysicalDevice gpu, const std::string& path);
+	void destroy();
+
+	vk::PipelineCache cache() const {
+		return mainCache;
+	}
+
+	// a private cache for a thread compiling pipelines; merged into the main cache on save
+	vk::PipelineCache createWorkerCache();
+
+	// merges worker caches and atomically replaces the file
+	bool save();
+
+private:
+	bool validate(const uint8_t* blob, size_t size) const;
+
+	vk::Device device;
+	vk::PhysicalDeviceProperties props;
+	std::string path;
+	vk::PipelineCache mainCache;
+	std::mutex workerMutex;
+	std::vector<vk::PipelineCache> workerCaches;
+};
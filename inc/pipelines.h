@@ -0,0 +1,103 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "drawlist.h"
+#include "pipelinecache.h"
+#include "reflect.h"
+#include "shaders.h"
+#include "threadpool.h"
+
+// one graphics pipeline permutation; vertex input and layout come from reflecting its shaders
+struct pipelineDesc {
+	std::string vertexShader;
+	std::string fragmentShader;
+	vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+	vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+	vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+	bool blend = false;
+
+	bool operator==(const pipelineDesc& other) const = default;
+};
+
+struct pipelineDescHash {
+	size_t operator()(const pipelineDesc& desc) const;
+};
+
+using pipelineHandle = uint32_t;
+const pipelineHandle invalidPipeline = UINT32_MAX;
+
+// compiles pipelines on its own worker threads so a new permutation never stalls a frame
+//
+// request() returns immediately; until the pipeline is ready, resolve() hands out the fallback (or a
+// null pipeline, meaning skip the draw), and handles stay valid across hot reloads. each compile job
+// borrows one of the worker caches, so no two threads share a VkPipelineCache, and the store merges
+// them when it is saved
+struct pipelineManager {
+	void init(vk::Device device, pipelineCacheStore& cacheStore, shaderRegistry& shaders, layoutCache& layouts,
+		unsigned threadCount);
+	// must be called before requests; vertex inputs are matched to semantics by location
+	void setTarget(vk::RenderPass renderPass, uint32_t vertexStride, std::vector<vertexInputMatch> semantics);
+	// switches the vertex layout once running compiles have landed and recompiles every pipeline against
+	// it, discarding pending reloads; returns the pipelines it replaced, which frames in flight may still
+	// be using. until a pipeline has recompiled, resolve() hands out the fallback
+	std::vector<vk::Pipeline> retarget(uint32_t vertexStride, std::vector<vertexInputMatch> semantics);
+	void destroy();
+
+	pipelineHandle request(const pipelineDesc& desc);
+	bool ready(pipelineHandle handle) const;
+	// ready pipeline, or fallback while it is still compiling
+	vk::Pipeline resolve(pipelineHandle handle, vk::Pipeline fallback) const;
+	// also sets each draw's layout, fallbackLayout for draws that get the fallback
+	void resolveDraws(std::vector<drawItem>& draws, vk::Pipeline fallback, vk::PipelineLayout fallbackLayout = nullptr) const;
+	// blocks until the pipeline has compiled; used for pipelines the first frame cannot do without
+	vk::Pipeline wait(pipelineHandle handle);
+	// shared with every pipeline of the same interface; valid once the pipeline is ready
+	vk::PipelineLayout layout(pipelineHandle handle) const;
+
+	// recompiles every pipeline using shaderPath in the background; returns how many were affected
+	size_t reload(const std::string& shaderPath);
+	// call at a frame boundary: publishes finished reloads and returns the pipelines they replaced,
+	// which frames in flight may still be using
+	std::vector<vk::Pipeline> swapReloaded();
+
+private:
+	struct entry {
+		pipelineDesc desc;
+		std::shared_future<vk::Pipeline> future;
+		vk::PipelineLayout layout;
+		std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+		// hot reload compiles beside the live pipeline until swapReloaded
+		std::shared_future<vk::Pipeline> replacement;
+		vk::PipelineLayout replacementLayout;
+		bool reloading = false;
+		bool reloadAgain = false;
+	};
+
+	std::shared_future<vk::Pipeline> submitCompile(entry& item, vk::PipelineLayout& layoutOut, bool publish);
+	vk::Pipeline compile(const pipelineDesc& desc, vk::PipelineCache cache, vk::PipelineLayout& layout);
+	vk::PipelineCache borrowCache();
+	void returnCache(vk::PipelineCache cache);
+
+	vk::Device device;
+	pipelineCacheStore* cacheStore = nullptr;
+	shaderRegistry* shaders = nullptr;
+	layoutCache* layouts = nullptr;
+	std::unique_ptr<threadPool> compilers;
+
+	vk::RenderPass renderPass;
+	uint32_t vertexStride = 0;
+	std::vector<vertexInputMatch> semantics;
+
+	mutable std::mutex mutex;
+	std::deque<entry> entries;
+	std::unordered_map<pipelineDesc, pipelineHandle, pipelineDescHash> lookup;
+	std::vector<vk::PipelineCache> freeCaches;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// what a pipeline needs to know about one shader stage, read straight from its SPIR-V
+
+struct reflectedInput {
+	uint32_t location;
+	vk::Format format;
+	std::string name;
+};
+
+struct reflectedBinding {
+	uint32_t set;
+	uint32_t binding;
+	vk::DescriptorType type;
+	uint32_t count;		// 0 for runtime-sized arrays
+	vk::ShaderStageFlags stages;
+	std::string name;
+};
+
+struct reflectedSpecConstant {
+	uint32_t id;
+	uint32_t size;
+	std::string name;
+};
+
+struct shaderReflection {
+	vk::ShaderStageFlagBits stage = vk::ShaderStageFlagBits::eVertex;
+	std::vector<reflectedInput> inputs;		// vertex stage only, sorted by location
+	std::vector<reflectedBinding> bindings;
+	std::vector<vk::PushConstantRange> pushConstants;
+	std::string pushConstantBlock;		// type name of the push_constant block; empty without debug names
+	std::vector<reflectedSpecConstant> specConstants;
+};
+
+// false when the module is malformed or uses a type reflection cannot describe
+bool reflectSpirv(const uint32_t* code, size_t wordCount, shaderReflection& out);
+
+// vertex inputs are matched to members of the vertex struct by location, so modules stripped of debug
+// names still bind; a match with a name takes the input of exactly that name instead, whatever its location
+struct vertexInputMatch {
+	uint32_t location;
+	uint32_t offset;
+	// what the buffer holds; left undefined, the format the shader declares is assumed
+	vk::Format format = vk::Format::eUndefined;
+	const char* name = nullptr;
+};
+
+bool buildVertexInput(const shaderReflection& vertexStage, uint32_t stride, const std::vector<vertexInputMatch>& semantics,
+	vk::VertexInputBindingDescription& binding, std::vector<vk::VertexInputAttributeDescription>& attributes);
+
+// reflects the shipped shaders, with and without their debug names, and binds their vertex inputs;
+// logs every check that fails
+bool reflectionSelfTest();
+
+// deduplicated descriptor set and pipeline layouts; pipelines with the same interface share one layout,
+// so switching between them keeps descriptor sets bound
+struct layoutCache {
+	void init(vk::Device device);
+	void destroy();
+
+	vk::DescriptorSetLayout setLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+	// merges the stages' bindings and push constants; safe to call from compile threads
+	vk::PipelineLayout pipelineLayout(const std::vector<const shaderReflection*>& stages);
+
+	size_t setLayoutCount() const;
+	size_t pipelineLayoutCount() const;
+
+private:
+	vk::DescriptorSetLayout setLayoutLocked(const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+
+	vk::Device device;
+	mutable std::mutex mutex;
+	std::map<std::vector<uint32_t>, vk::DescriptorSetLayout> setLayouts;
+	std::map<std::vector<uint64_t>, vk::PipelineLayout> pipelineLayouts;
+};
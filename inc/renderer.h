@@ -1,6 +1,24 @@
 #pragma once
 #include <GLFW/glfw3.h>
+#include <deque>
+#include <functional>
 #include <vector>
+#include "allocator.h"
+#include "cpuprofiler.h"
+#include "culling.h"
+#include "drawlist.h"
+#include "frame.h"
+#include "gpuprofiler.h"
+#include "hotreload.h"
+#include "meshlet.h"
+#include "meshletcull.h"
+#include "pacing.h"
+#include "pipelinecache.h"
+#include "pipelines.h"
+#include "shaders.h"
+#include "threadpool.h"
+#include "upload.h"
+#include "vertexformat.h"
 
 using namespace vk;
 const uint32_t width = 800;
@@ -10,28 +28,113 @@ const uint32_t height = 600;
 struct renderer {
 	GLFWwindow* window;
 	Extent2D extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	bool framebufferResized = false;
 
 	UniqueInstance instance;
 	PhysicalDevice gpu;
 	UniqueDevice device;
 	Queue gfxQueue;
 	Queue presentQueue;
+	Queue transferQueue;
+	uint32_t gfxFamily = 0;
+	uint32_t transferFamily = 0;
 	SurfaceKHR surface;
 	SwapchainKHR swapchain;
+	presentPolicy presentPreference = presentPolicy::mailbox;
+	uint32_t swapchainImageCount = 0;	// 0 picks minImageCount + 1
+	PresentModeKHR presentMode = PresentModeKHR::eFifo;
+	framePacer pacer;
+
+	// headless renders into offscreen images, one per frame in flight, with no window or swapchain
+	bool headless = false;
+	// copies every headless frame into a host-visible buffer for readback()
+	bool captureFrames = false;
+	std::vector<allocation> offscreenMemory;
+	std::vector<Buffer> readbackBuffers;
+	std::vector<allocation> readbackMemory;
+	uint32_t lastFrameIndex = 0;
+
 	RenderPass rp;
 	std::vector<Image> images;
 	std::vector<ImageView> imageViews;
 	std::vector<Framebuffer> framebuffers;
  	Pipeline pipeline;
-	PipelineLayout pipelineLayout;
-	CommandPool commandPool;
-	std::vector<CommandBuffer> commandBuffers;
- 	ImageSubresourceRange imgRange;
+	PipelineLayout pipelineLayout;	// the default pipeline's, owned by layouts
+	shaderRegistry shaders;
+	layoutCache layouts;
+	bool shaderIdentifiers = false;
+	pipelineCacheStore pipelineCache;
+	pipelineManager pipelines;
+	pipelineHandle defaultPipeline = invalidPipeline;
+	// draws whose pipeline is still compiling use the default pipeline instead of being skipped
+	bool useFallbackPipeline = true;
+	// watch the GLSL sources and recompile them with glslc while running; a development aid that shells
+	// out to the compiler, so off unless asked for (--hot-reload)
+	bool hotReload = false;
+	shaderHotReload shaderReload;
+
+	// the default pipeline's vertex shader: the packedVertex decoder built from packed.vert when it
+	// exists, else shader.vert; vertexFormat follows its reflection, at startup and whenever either is
+	// rebuilt
+	std::string vertexShader;
+	vertexEncoding vertexFormat = vertexEncoding::full;
+	// per-submesh vertex offsets and position ranges; the packed vertices are dropped after upload
+	quantizedMesh packedGeometry;
+
+	// re-recorded into the frame's command buffer every frame
+	drawList scene;
+	// >1 splits the draw list across worker threads recording secondary command buffers
+	uint32_t recordThreads = 1;
+	// below this many draws per thread the dispatch costs more than it saves
+	uint32_t minDrawsPerThread = 256;
+	// rebuilds the model's full-detail draws every frame as indirect draws of the meshlets that survive
+	// culling; off draws them whole
+	bool meshletCulling = true;
+	// culls them in a compute pass writing the indirect commands instead, when shaders/cull.spv loads,
+	// the graphics queue runs compute and indirect draws take several commands (--cpu-meshlet-cull for off)
+	bool gpuMeshletCulling = true;
+	meshletCullPass meshletCull;
+	Buffer meshletBuffer;
+	allocation meshletMemory;
+	// no camera yet: shader.vert puts x and y straight into clip space and drops z, which is an
+	// orthographic view down -z
+	glm::mat4 viewProj{ 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+	glm::vec3 viewForward{ 0.0f, 0.0f, -1.0f };
+	// the coarsest LOD whose error stays under this many pixels is drawn; 0 always draws full detail
+	float lodPixelError = 1.0f;
+	// a submesh moves to a coarser level only once its error fits this much under the threshold
+	float lodHysteresis = 0.25f;
+	// per submesh, carried between frames for the hysteresis
+	std::vector<uint32_t> lodLevels;
+	cullBounds submeshBounds;
+	std::vector<uint32_t> visibleSubmeshes;
+	uint32_t visibleMeshlets = 0;
+	uint32_t drawnTriangles = 0;
+	ImageSubresourceRange imgRange;
+
+	// frames the CPU may record ahead of the GPU
+	uint32_t framesInFlight = 2;
+	std::vector<frameContext> frames;
+	uint32_t frameIndex = 0;
+	std::vector<Semaphore> renderSemaphores;
+
+	// signalled with the frame number by every frame submission
+	Semaphore frameTimeline;
+	uint64_t frameCounter = 0;
+
+	struct deferredDestroy {
+		uint64_t frame;
+		std::function<void()> destroy;
+	};
+	std::deque<deferredDestroy> garbage;
 
-	Semaphore imgSemaphore;
-	Semaphore renderSemaphore;
+	// per-region GPU times of the frames recorded here
+	gpuProfiler gpuProfile;
 
-	Fence fence;
+	threadPool workers;
+	vulkanMemoryBackend memBackend;
+	gpuAllocator allocator;
+	uploadRing uploads;
 public:
 	bool createInstance();
 	bool createSurface();
@@ -39,22 +142,56 @@ public:
 	bool createDevice();
 
 	bool createSwapchain();
+	bool createOffscreenTargets();
+	void recordReadback(CommandBuffer cmd, uint32_t imgIndex);
+	// waits for the last submitted headless frame and returns it as tightly packed RGBA8
+	bool readback(std::vector<uint8_t>& rgba);
+	double runHeadless(uint32_t frameCount);
+	void recreateSwapchain();
 	bool createImageViews();
 	bool createRenderPass();
+	bool createPipelineCache();
 	bool createPipeline();
+	void createHotReload();
+	// returns whether the vertex shader or its encoding changed
+	bool selectVertexShader();
+	// re-uploads the geometry and recompiles the pipelines when a rebuilt shader wants another encoding
+	void reloadVertexShader();
+	void swapReloadedPipelines();
 	bool createFramebuffers();
 	bool createCommandPool();
+	void createProfiler();
 	bool createCommandBuffers();
-	ShaderModule createShaderModule(const std::vector<char>& code);
+	void recordCommandBuffer(frameContext& frame, uint32_t imgIndex);
+	void setViewportScissor(CommandBuffer cmd);
+	uint32_t recordSlots(const frameContext& frame) const;
+	void benchmarkRecording(uint32_t drawCount, uint32_t iterations);
+	void buildDrawList();
+	// culls submeshes to the view, picks a LOD for the rest and culls the meshlets of those drawn at full detail
+	void selectGeometry(frameContext& frame);
+	bool createTransientBuffers();
 	bool createSemaphores();
-	bool createFence();
+	bool createRenderSemaphores();
+	bool createTimeline();
+	uint64_t completedFrame();
+	bool frameComplete(uint64_t frame);
+	void deferDestroy(std::function<void()> destroy);
+	void collectGarbage();
 	void render();
-	std::vector<char>   readSpv(const std::string filename);
+	const latencyStats& latency() const {
+		return pacer.stats();
+	}
 	void init();
 	void cleanup();
 	void update();
 	void windowInit();
+	void createAllocator();
+	void createBuffer(DeviceSize size, BufferUsageFlags usage, MemoryPropertyFlags properties,
+		Buffer& buffer, allocation& memory);
+	void createUploadRing();
 	void createVertexBuffer();
+	void createIndexBuffer();
+	void createMeshletCulling();
 	void loadModel();
 } ;
 
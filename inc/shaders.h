@@ -0,0 +1,45 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "reflect.h"
+
+const uint32_t spirvMagic = 0x07230203;
+
+// owns every VkShaderModule, deduplicated by the FNV-1a hash of its SPIR-V
+//
+// files are memory-mapped, reflected and handed to the driver straight from the mapping; with
+// VK_EXT_shader_module_identifier the driver's identifier for each module is kept too, so
+// pipelines can later be looked up in the pipeline cache without the module
+struct shaderRegistry {
+	void init(vk::Device device, bool moduleIdentifiers);
+	void destroy();
+
+	// null when the file is missing or is not valid SPIR-V; safe to call from compile threads
+	vk::ShaderModule load(const std::string& path, shaderReflection* reflection = nullptr);
+	vk::ShaderModule find(uint64_t hash) const;
+	// content hash of the module path last loaded as, 0 when it never was
+	uint64_t hashOf(const std::string& path) const;
+	// empty when the extension is unavailable
+	std::vector<uint8_t> identifier(uint64_t hash) const;
+
+	size_t moduleCount() const;
+
+private:
+	struct entry {
+		vk::ShaderModule module;
+		shaderReflection reflection;
+		std::vector<uint8_t> identifier;
+	};
+
+	vk::Device device;
+	bool identifiers = false;
+	mutable std::mutex mutex;
+	std::unordered_map<uint64_t, entry> modules;
+	std::unordered_map<std::string, uint64_t> paths;
+};
+
+bool validateSpirv(const void* code, size_t size);
@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fixed set of worker threads draining a shared FIFO of jobs
+struct threadPool {
+	explicit threadPool(unsigned threadCount = std::thread::hardware_concurrency());
+	threadPool(const threadPool&) = delete;
+	threadPool& operator=(const threadPool&) = delete;
+	~threadPool();
+
+	unsigned size() const {
+		return static_cast<unsigned>(workers.size());
+	}
+
+	template<typename F>
+	auto submit(F&& job) -> std::future<std::invoke_result_t<F>> {
+		using result_t = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(job));
+		std::future<result_t> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.emplace([task]() { (*task)(); });
+		}
+		wake.notify_one();
+		return result;
+	}
+
+	// runs fn(0..count-1) on the pool and blocks until every call has returned
+	void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+};
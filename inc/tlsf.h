@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// two-level segregated fit allocator over an abstract [0, size) range
+//
+// keeps no memory of its own beyond bookkeeping nodes; offsets are handed out with O(1)
+// allocate and free, free neighbours are merged immediately
+struct tlsf {
+	static const uint32_t invalid = UINT32_MAX;
+
+	void init(uint64_t size);
+
+	// returns a node handle or invalid when no free range can hold size bytes at the alignment
+	uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	void free(uint32_t node);
+
+	uint64_t capacity() const {
+		return total;
+	}
+	uint64_t used() const {
+		return usedBytes;
+	}
+	uint32_t allocationCount() const {
+		return liveCount;
+	}
+	bool empty() const {
+		return liveCount == 0;
+	}
+
+private:
+	static const uint32_t slBits = 4;
+	static const uint32_t slCount = 1u << slBits;
+	static const uint32_t flCount = 64 - slBits + 1;
+
+	struct node {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhys;
+		uint32_t nextPhys;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		bool free;
+	};
+
+	static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+	uint32_t newNode();
+	void insertFree(uint32_t n);
+	void removeFree(uint32_t n);
+	uint32_t findFree(uint64_t size);
+	uint32_t split(uint32_t n, uint64_t size);
+
+	std::vector<node> nodes;
+	std::vector<uint32_t> spareNodes;
+	uint32_t heads[flCount][slCount];
+	uint64_t flBitmap = 0;
+	uint32_t slBitmap[flCount];
+
+	uint64_t total = 0;
+	uint64_t usedBytes = 0;
+	uint32_t liveCount = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <cstdint>
+#include "allocator.h"
+
+// persistent host-visible staging ring feeding copy commands on a (preferably dedicated) transfer queue
+//
+// bytes are handed out from a monotonically growing offset modulo the ring capacity; every submitted
+// batch signals the next value of the ring's timeline semaphore and remembers how far the ring had
+// advanced, so once the timeline reaches a batch everything before that point can be overwritten
+struct uploadRing {
+	void init(vk::Device device, gpuAllocator& allocator, vk::Queue queue, uint32_t queueFamily,
+		vk::DeviceSize capacity);
+	void destroy();
+
+	// copies size bytes into dst at dstOffset; only blocks when the ring is full of in-flight data
+	void uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+
+	// submits recorded copies and returns the timeline value they signal, 0 when nothing was pending
+	uint64_t submit();
+	bool complete(uint64_t batchId);
+	void wait(uint64_t batchId);
+
+	uint64_t lastSubmitted() const {
+		return nextBatchId - 1;
+	}
+
+	// other queues wait on this at lastSubmitted() before reading uploaded data
+	vk::Semaphore timeline() const {
+		return timelineSemaphore;
+	}
+
+private:
+	struct batch {
+		vk::CommandBuffer cmd;
+		uint64_t id = 0;
+		uint64_t ringHead = 0;
+		bool inFlight = false;
+	};
+
+	static const uint32_t batchCount = 4;
+	static const vk::DeviceSize copyAlignment = 16;
+
+	vk::DeviceSize reserve(vk::DeviceSize size);
+	void retire(batch& b);
+	batch* oldestInFlight();
+
+	vk::Device device;
+	vk::Queue queue;
+	vk::CommandPool pool;
+	vk::Semaphore timelineSemaphore;
+	gpuAllocator* allocator = nullptr;
+	vk::Buffer staging;
+	allocation stagingMem;
+	uint8_t* mapped = nullptr;
+	vk::DeviceSize capacity = 0;
+
+	uint64_t head = 0;		// total bytes ever reserved
+	uint64_t tail = 0;		// total bytes whose copies have completed
+
+	std::array<batch, batchCount> batches;
+	uint32_t current = 0;
+	bool recording = false;
+	uint64_t nextBatchId = 1;
+	uint64_t completedId = 0;
+};
@@ -1 +1,35 @@
- 
\ No newline at end of file
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// read-only memory mapping of a whole file
+struct mappedFile {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+	mappedFile() = default;
+	mappedFile(const mappedFile&) = delete;
+	mappedFile& operator=(const mappedFile&) = delete;
+	mappedFile(mappedFile&& other) noexcept;
+	mappedFile& operator=(mappedFile&& other) noexcept;
+	~mappedFile();
+
+	bool open(const std::string& path);
+	void close();
+
+private:
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+// 64-bit FNV-1a, chainable through seed
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// writes beside path and renames over it, so a crash never leaves a half-written file
+bool writeFileAtomic(const std::string& path, const void* data, size_t size);
+
+// binary PPM (P6) from tightly packed RGBA8; alpha is dropped
+bool writePpm(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba);
@@ -0,0 +1,58 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+#include "reflect.h"
+
+// how vertices are stored in the vertex buffer
+enum class vertexEncoding {
+	full,		// Vertex as loaded: float position, normal and uv, 32 bytes
+	quantized	// packedVertex, 20 bytes
+};
+
+// positions as unorm16 within their submesh's bounds, octahedral normal and tangent, half-float uvs
+struct packedVertex {
+	uint16_t pos[4];		// xyz, w holds the bitangent sign: 0 for -1, 65535 for +1
+	int16_t normal[2];		// octahedral, snorm16
+	int16_t tangent[2];		// octahedral, snorm16
+	uint16_t texCoord[2];	// half floats
+};
+static_assert(sizeof(packedVertex) == 20, "packedVertex must stay tightly packed");
+
+// pushed per draw; the vertex shader decodes position as offset + unorm * scale
+struct positionDequant {
+	glm::vec4 scale;
+	glm::vec4 offset;
+};
+
+// stride and attribute formats for one encoding, matched to shader inputs by location: position at 0,
+// normal at 1, then tangent (quantized only) and uv
+struct vertexLayout {
+	vertexEncoding encoding;
+	uint32_t stride;
+	std::vector<vertexInputMatch> attributes;
+
+	static vertexLayout make(vertexEncoding encoding);
+};
+
+// quantized for a vertex shader whose push_constant block is named positionDequant, as packed.vert's
+// is; full for any other, shader.vert included, and for modules stripped of debug names
+vertexEncoding vertexEncodingOf(const shaderReflection& vertexStage);
+const char* to_string(vertexEncoding encoding);
+
+// quantized copy of a mesh
+//
+// every submesh owns a contiguous vertex range so it can be quantized against its own bounds; indices
+// are local to that range and drawn with the submesh's vertexOffset, so they fit in 16 bits as long
+// as no single submesh has more than 65535 vertices
+struct quantizedMesh {
+	std::vector<packedVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<int32_t> vertexOffsets;			// per submesh
+	std::vector<positionDequant> dequant;		// per submesh
+	uint32_t maxSubmeshVertices = 0;
+};
+
+quantizedMesh quantizeMesh(const meshView& geometry);
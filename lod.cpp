@@ -0,0 +1,459 @@
+#include "lod.h"
+#include "meshopt.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+	const uint32_t noVertex = UINT32_MAX;
+	// more than one open edge leaves the vertex
+	const uint32_t manyVertices = UINT32_MAX - 1;
+
+	// a level under this many triangles is not worth a draw of its own
+	const size_t minLodTriangles = 16;
+	// a level keeping more than this share of the previous level's triangles is not worth storing
+	const float minLodReduction = 0.85f;
+
+	enum class vertexKind : uint8_t {
+		manifold,	// interior, one attribute set: collapses anywhere
+		border,		// on an open edge: collapses only along it
+		seam,		// two attribute sets meeting along an edge: collapses only along it, both sides together
+		locked		// corners, non-manifold and everything else: never moves
+	};
+
+	// error of moving to p is p'Ap + 2b'p + c over the accumulated planes; weight is their total area
+	struct quadric {
+		float a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+		float b0 = 0, b1 = 0, b2 = 0, c = 0;
+		float weight = 0;
+
+		static quadric plane(glm::vec3 n, float d, float w) {
+			quadric q;
+			q.a00 = w * n.x * n.x; q.a11 = w * n.y * n.y; q.a22 = w * n.z * n.z;
+			q.a10 = w * n.y * n.x; q.a20 = w * n.z * n.x; q.a21 = w * n.z * n.y;
+			q.b0 = w * n.x * d; q.b1 = w * n.y * d; q.b2 = w * n.z * d;
+			q.c = w * d * d;
+			return q;
+		}
+
+		void operator+=(const quadric& o) {
+			a00 += o.a00; a11 += o.a11; a22 += o.a22; a10 += o.a10; a20 += o.a20; a21 += o.a21;
+			b0 += o.b0; b1 += o.b1; b2 += o.b2; c += o.c;
+			weight += o.weight;
+		}
+
+		float evaluate(glm::vec3 p) const {
+			float rx = a00 * p.x + a10 * p.y + a20 * p.z + 2.0f * b0;
+			float ry = a10 * p.x + a11 * p.y + a21 * p.z + 2.0f * b1;
+			float rz = a20 * p.x + a21 * p.y + a22 * p.z + 2.0f * b2;
+			return std::abs(rx * p.x + ry * p.y + rz * p.z + c);
+		}
+	};
+
+	// can a vertex of the first kind move onto one of the second
+	const bool canCollapse[4][4] = {
+		{ true, true, true, true },
+		{ false, true, false, true },
+		{ false, false, true, true },
+		{ false, false, false, false }
+	};
+
+	struct collapse {
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	// outgoing half-edges of every vertex, as offsets into one flat list
+	struct edgeAdjacency {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> targets;
+
+		void build(const uint32_t* indices, size_t indexCount, size_t vertexCount, const uint32_t* remap) {
+			offsets.assign(vertexCount + 1, 0);
+			targets.resize(indexCount);
+			for (size_t i = 0; i < indexCount; i++) {
+				offsets[remap ? remap[indices[i]] + 1 : indices[i] + 1]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indexCount; i += 3) {
+				for (size_t k = 0; k < 3; k++) {
+					uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+					if (remap) {
+						a = remap[a];
+						b = remap[b];
+					}
+					targets[fill[a]++] = b;
+				}
+			}
+		}
+
+		bool has(uint32_t a, uint32_t b) const {
+			return std::find(targets.begin() + offsets[a], targets.begin() + offsets[a + 1], b) != targets.begin() + offsets[a + 1];
+		}
+	};
+
+	// vertices sharing a position: remap to the first of them, wedge around all of them in a ring
+	void buildPositionRemap(const Vertex* vertices, size_t vertexCount, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge) {
+		std::unordered_map<glm::vec3, uint32_t> first;
+		first.reserve(vertexCount);
+		remap.resize(vertexCount);
+		wedge.resize(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			auto [it, inserted] = first.try_emplace(vertices[v].pos, v);
+			remap[v] = it->second;
+			if (inserted) {
+				wedge[v] = v;
+			}
+			else {
+				wedge[v] = wedge[it->second];
+				wedge[it->second] = v;
+			}
+		}
+	}
+
+	// the vertex at the far end of each vertex's single open edge, in and out; manyVertices when there
+	// are several
+	void findOpenEdges(const uint32_t* indices, size_t indexCount, const edgeAdjacency& edges,
+		std::vector<uint32_t>& openOut, std::vector<uint32_t>& openIn) {
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+				if (edges.has(b, a)) {
+					continue;
+				}
+				openOut[a] = openOut[a] == noVertex ? b : manyVertices;
+				openIn[b] = openIn[b] == noVertex ? a : manyVertices;
+			}
+		}
+	}
+
+	bool single(uint32_t v) {
+		return v != noVertex && v != manyVertices;
+	}
+
+	void classifyVertices(size_t vertexCount, const std::vector<uint32_t>& remap, const std::vector<uint32_t>& wedge,
+		const std::vector<uint32_t>& openOut, const std::vector<uint32_t>& openIn, std::vector<vertexKind>& kinds) {
+		kinds.assign(vertexCount, vertexKind::locked);
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			if (remap[v] != v) {
+				continue;
+			}
+			if (wedge[v] == v) {
+				if (openOut[v] == noVertex && openIn[v] == noVertex) {
+					kinds[v] = vertexKind::manifold;
+				}
+				else if (single(openOut[v]) && single(openIn[v])) {
+					kinds[v] = vertexKind::border;
+				}
+			}
+			else if (wedge[wedge[v]] == v) {
+				// a seam runs through when each side has one open edge in and out and they are the same
+				// two edges seen from either side
+				uint32_t w = wedge[v];
+				if (single(openOut[v]) && single(openIn[v]) && single(openOut[w]) && single(openIn[w])
+					&& remap[openIn[v]] == remap[openOut[w]] && remap[openOut[v]] == remap[openIn[w]]
+					&& remap[openIn[v]] != remap[openOut[v]]) {
+					kinds[v] = vertexKind::seam;
+				}
+			}
+		}
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			kinds[v] = kinds[remap[v]];
+		}
+	}
+
+	// follows an open edge past a vertex that collapsed onto its neighbour
+	void remapOpenEdges(std::vector<uint32_t>& open, const std::vector<uint32_t>& collapseRemap) {
+		for (uint32_t v = 0; v < open.size(); v++) {
+			if (!single(open[v])) {
+				continue;
+			}
+			uint32_t target = collapseRemap[open[v]];
+			open[v] = target == v ? (single(open[open[v]]) ? collapseRemap[open[open[v]]] : noVertex) : target;
+		}
+	}
+}
+
+size_t simplifyMesh(uint32_t* dst, const uint32_t* indices, size_t indexCount, const Vertex* vertices,
+	size_t vertexCount, size_t targetIndexCount, float errorLimit, float& error) {
+	error = 0.0f;
+	std::copy(indices, indices + indexCount, dst);
+	if (indexCount <= targetIndexCount) {
+		return indexCount;
+	}
+
+	std::vector<uint32_t> remap, wedge;
+	buildPositionRemap(vertices, vertexCount, remap, wedge);
+
+	edgeAdjacency edges;
+	edges.build(dst, indexCount, vertexCount, nullptr);
+	std::vector<uint32_t> openOut(vertexCount, noVertex), openIn(vertexCount, noVertex);
+	findOpenEdges(dst, indexCount, edges, openOut, openIn);
+
+	std::vector<vertexKind> kinds;
+	classifyVertices(vertexCount, remap, wedge, openOut, openIn, kinds);
+
+	// plane quadrics weighted by area, plus planes through open edges standing on their triangle so
+	// borders and seams resist moving sideways
+	std::vector<quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indexCount; i += 3) {
+		uint32_t corner[3] = { dst[i], dst[i + 1], dst[i + 2] };
+		glm::vec3 p0 = vertices[corner[0]].pos, p1 = vertices[corner[1]].pos, p2 = vertices[corner[2]].pos;
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(n);
+		if (area == 0.0f) {
+			continue;
+		}
+		n /= area;
+		quadric q = quadric::plane(n, -glm::dot(n, p0), area);
+		q.weight = area;
+		for (uint32_t v : corner) {
+			quadrics[remap[v]] += q;
+		}
+
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t a = corner[k], b = corner[(k + 1) % 3];
+			if (openOut[a] != b) {
+				continue;
+			}
+			glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+			float length = glm::length(edge);
+			if (length == 0.0f) {
+				continue;
+			}
+			glm::vec3 side = glm::normalize(glm::cross(edge, n));
+			quadric edgeQuadric = quadric::plane(side, -glm::dot(side, vertices[a].pos), length * length * 2.0f);
+			quadrics[remap[a]] += edgeQuadric;
+			quadrics[remap[b]] += edgeQuadric;
+		}
+	}
+
+	size_t count = indexCount;
+	std::vector<collapse> candidates;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> triangleOffsets, triangleList;
+	float maxError = 0.0f;
+
+	while (count > targetIndexCount) {
+		// triangles around every position, for flip checks
+		triangleOffsets.assign(vertexCount + 1, 0);
+		triangleList.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			triangleOffsets[remap[dst[i]] + 1]++;
+		}
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+		std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < count; i++) {
+			triangleList[fill[remap[dst[i]]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		candidates.clear();
+		for (size_t i = 0; i < count; i += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				uint32_t a = dst[i + k], b = dst[i + (k + 1) % 3];
+				for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+					vertexKind kind = kinds[from];
+					if (!canCollapse[size_t(kind)][size_t(kinds[to])]) {
+						continue;
+					}
+					if ((kind == vertexKind::border || kind == vertexKind::seam) && openOut[from] != to && openIn[from] != to) {
+						continue;
+					}
+					quadric q = quadrics[remap[from]];
+					q += quadrics[remap[to]];
+					float e = q.weight > 0.0f ? q.evaluate(vertices[to].pos) / q.weight : 0.0f;
+					candidates.push_back({ from, to, e });
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const collapse& x, const collapse& y) { return x.error < y.error; });
+
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+		// manifold and seam collapses take two triangles with them, border collapses one
+		size_t goal = (count - targetIndexCount) / 3;
+		size_t removed = 0;
+		size_t collapses = 0;
+
+		for (const collapse& c : candidates) {
+			if (removed >= goal || std::sqrt(c.error) > errorLimit) {
+				break;
+			}
+			uint32_t r0 = remap[c.from], r1 = remap[c.to];
+			if (touched[r0] || touched[r1]) {
+				continue;
+			}
+
+			// reject collapses that turn a remaining triangle over or fold it nearly flat
+			glm::vec3 target = vertices[c.to].pos;
+			bool flips = false;
+			for (uint32_t t = triangleOffsets[r0]; t < triangleOffsets[r0 + 1] && !flips; t++) {
+				const uint32_t* tri = dst + triangleList[t] * 3;
+				uint32_t p[3] = { remap[tri[0]], remap[tri[1]], remap[tri[2]] };
+				if (p[0] == r1 || p[1] == r1 || p[2] == r1) {
+					continue;
+				}
+				glm::vec3 before[3], after[3];
+				for (size_t k = 0; k < 3; k++) {
+					before[k] = vertices[tri[k]].pos;
+					after[k] = p[k] == r0 ? target : before[k];
+				}
+				glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(n0, n1) < 0.25f * glm::length(n0) * glm::length(n1);
+			}
+			if (flips) {
+				continue;
+			}
+
+			// no other collapse this pass may move anything these triangles touch
+			for (uint32_t t = triangleOffsets[r0]; t < triangleOffsets[r0 + 1]; t++) {
+				const uint32_t* tri = dst + triangleList[t] * 3;
+				for (size_t k = 0; k < 3; k++) {
+					touched[remap[tri[k]]] = true;
+				}
+			}
+			touched[r1] = true;
+
+			vertexKind kind = kinds[c.from];
+			collapseRemap[c.from] = c.to;
+			if (kind == vertexKind::seam) {
+				// the other side of the seam follows along its own open edge
+				uint32_t s0 = wedge[c.from];
+				uint32_t s1 = openOut[c.from] == c.to ? openIn[s0] : openOut[s0];
+				collapseRemap[s0] = s1;
+			}
+			quadrics[r1] += quadrics[r0];
+			maxError = std::max(maxError, c.error);
+			removed += kind == vertexKind::border ? 1 : 2;
+			collapses++;
+		}
+
+		if (collapses == 0) {
+			break;
+		}
+
+		// drop triangles that lost an edge
+		size_t write = 0;
+		for (size_t i = 0; i < count; i += 3) {
+			uint32_t a = collapseRemap[dst[i]], b = collapseRemap[dst[i + 1]], c = collapseRemap[dst[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+				continue;
+			}
+			dst[write++] = a;
+			dst[write++] = b;
+			dst[write++] = c;
+		}
+		count = write;
+
+		remapOpenEdges(openOut, collapseRemap);
+		remapOpenEdges(openIn, collapseRemap);
+	}
+
+	error = std::sqrt(maxError);
+	return count;
+}
+
+void buildLods(mesh& m, uint32_t maxLevels) {
+	m.lods.clear();
+
+	// like optimizeMesh, every submesh is simplified on its own compact vertex numbering
+	std::vector<uint32_t> owner(m.vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> local(m.vertices.size());
+	std::vector<uint32_t> global;
+	std::vector<Vertex> localVertices;
+	std::vector<uint32_t> current, next;
+
+	for (uint32_t s = 0; s < m.submeshes.size(); s++) {
+		submesh& part = m.submeshes[s];
+		part.firstLod = static_cast<uint32_t>(m.lods.size());
+		m.lods.push_back({ part.firstIndex, part.indexCount, 0.0f });
+
+		global.clear();
+		localVertices.clear();
+		current.resize(part.indexCount);
+		for (uint32_t i = 0; i < part.indexCount; i++) {
+			uint32_t v = m.indices[part.firstIndex + i];
+			if (owner[v] != s) {
+				owner[v] = s;
+				local[v] = static_cast<uint32_t>(global.size());
+				global.push_back(v);
+				localVertices.push_back(m.vertices[v]);
+			}
+			current[i] = local[v];
+		}
+
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		for (const Vertex& v : localVertices) {
+			lo = glm::min(lo, v.pos);
+			hi = glm::max(hi, v.pos);
+		}
+		part.center = localVertices.empty() ? glm::vec3(0.0f) : (lo + hi) * 0.5f;
+		float radius2 = 0.0f;
+		for (const Vertex& v : localVertices) {
+			radius2 = std::max(radius2, glm::dot(v.pos - part.center, v.pos - part.center));
+		}
+		part.radius = std::sqrt(radius2);
+
+		float error = 0.0f;
+		for (uint32_t level = 1; level < maxLevels; level++) {
+			size_t target = (current.size() / 3 / 2) * 3;
+			if (target < minLodTriangles * 3) {
+				break;
+			}
+			next.resize(current.size());
+			float levelError;
+			size_t count = simplifyMesh(next.data(), current.data(), current.size(), localVertices.data(),
+				localVertices.size(), target, FLT_MAX, levelError);
+			if (float(count) > float(current.size()) * minLodReduction) {
+				break;
+			}
+			next.resize(count);
+			optimizeVertexCache(next.data(), next.size(), localVertices.size());
+
+			// each level is simplified from its parent, so it strays from full detail by at most both errors
+			error += levelError;
+			m.lods.push_back({ static_cast<uint32_t>(m.indices.size()), static_cast<uint32_t>(count), error });
+			for (uint32_t v : next) {
+				m.indices.push_back(global[v]);
+			}
+			std::swap(current, next);
+		}
+
+		part.lodCount = static_cast<uint32_t>(m.lods.size()) - part.firstLod;
+	}
+}
+
+float lodPixelsPerUnit(const glm::mat4& viewProj, float viewportHeight, const submesh& part, const glm::vec3* eye) {
+	// clip-space y per object-space unit; a rigid view transform leaves the projection's scale
+	glm::vec3 yRow(viewProj[0][1], viewProj[1][1], viewProj[2][1]);
+	float scale = glm::length(yRow) * viewportHeight * 0.5f;
+	if (!eye) {
+		return scale;
+	}
+	float distance = glm::length(part.center - *eye) - part.radius;
+	return scale / std::max(distance, 1e-4f);
+}
+
+uint32_t selectLod(const meshLod* levels, uint32_t levelCount, uint32_t current, float pixelsPerUnit,
+	float threshold, float hysteresis) {
+	// errors never shrink down the chain, so the first level over the threshold ends the search
+	auto coarsest = [&](float limit) {
+		uint32_t level = 0;
+		while (level + 1 < levelCount && levels[level + 1].error * pixelsPerUnit <= limit) {
+			level++;
+		}
+		return level;
+	};
+
+	uint32_t level = coarsest(threshold);
+	if (level > current) {
+		return std::max(current, coarsest(threshold * (1.0f - hysteresis)));
+	}
+	return level;
+}
@@ -0,0 +1,183 @@
+#include "log.h"
+#include <cstdio>
+#include <mutex>
+
+logger engineLog;
+
+namespace {
+	std::atomic<uint32_t> threadCount{ 0 };
+	thread_local uint32_t threadIndex = threadCount.fetch_add(1, std::memory_order_relaxed);
+
+	// only taken on the synchronous path, where callers may race each other
+	std::mutex syncMutex;
+}
+
+const char* to_string(logLevel level) {
+	switch (level) {
+	case logLevel::trace: return "trace";
+	case logLevel::debug: return "debug";
+	case logLevel::info: return "info";
+	case logLevel::warn: return "warn";
+	case logLevel::error: return "error";
+	default: return "off";
+	}
+}
+
+bool parseLogLevel(std::string_view name, logLevel& level) {
+	for (logLevel candidate : { logLevel::trace, logLevel::debug, logLevel::info, logLevel::warn, logLevel::error, logLevel::off }) {
+		if (name == to_string(candidate)) {
+			level = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+logger::logger() : origin(std::chrono::steady_clock::now()) {
+}
+
+logger::~logger() {
+	shutdown();
+}
+
+void logger::init(format outputFormat) {
+	if (running.load()) {
+		return;
+	}
+	this->outputFormat = outputFormat;
+
+	slots = std::make_unique<slot[]>(queueSize);
+	for (uint32_t i = 0; i < queueSize; i++) {
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	enqueuePos.store(0, std::memory_order_relaxed);
+	dequeuePos = 0;
+
+	running.store(true);
+	writer = std::thread(&logger::writerLoop, this);
+}
+
+void logger::shutdown() {
+	if (!running.exchange(false)) {
+		return;
+	}
+	pushed.fetch_add(1);
+	pushed.notify_one();
+	writer.join();
+
+	if (uint64_t lost = dropped()) {
+		std::fprintf(stderr, "log: %llu messages dropped\n", static_cast<unsigned long long>(lost));
+	}
+}
+
+void logger::fill(record& item, const logLine& line, uint64_t timeNs) {
+	item.timeNs = timeNs;
+	item.thread = threadIndex;
+	item.length = line.length;
+	item.level = line.level;
+	item.truncated = line.truncated;
+	std::char_traits<char>::copy(item.text, line.text, line.length);
+}
+
+void logger::push(const logLine& line) {
+	uint64_t timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - origin).count());
+
+	if (!running.load(std::memory_order_acquire)) {
+		record item;
+		fill(item, line, timeNs);
+		std::lock_guard<std::mutex> lock(syncMutex);
+		write(item);
+		std::fflush(stdout);
+		return;
+	}
+
+	// claim a slot whose sequence says it is free for this lap of the ring
+	uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+	slot* target;
+	for (;;) {
+		target = &slots[pos % queueSize];
+		uint64_t sequence = target->sequence.load(std::memory_order_acquire);
+		int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+		if (diff == 0) {
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else {
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	fill(target->item, line, timeNs);
+	target->sequence.store(pos + 1, std::memory_order_release);
+
+	// the writer only needs a wake-up when it has gone to sleep on an empty queue
+	pushed.fetch_add(1);
+	if (writerSleeping.load()) {
+		pushed.notify_one();
+	}
+}
+
+void logger::writerLoop() {
+	for (;;) {
+		bool wrote = false;
+		for (;;) {
+			slot& next = slots[dequeuePos % queueSize];
+			if (next.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+				break;
+			}
+			write(next.item);
+			next.sequence.store(dequeuePos + queueSize, std::memory_order_release);
+			dequeuePos++;
+			wrote = true;
+		}
+		if (wrote) {
+			std::fflush(stdout);
+			continue;
+		}
+		if (!running.load()) {
+			return;
+		}
+
+		uint32_t seen = pushed.load();
+		writerSleeping.store(true);
+		// a record published before the flag was raised would otherwise wait for the next one
+		bool empty = slots[dequeuePos % queueSize].sequence.load() != dequeuePos + 1;
+		if (empty && running.load()) {
+			pushed.wait(seen);
+		}
+		writerSleeping.store(false);
+	}
+}
+
+void logger::write(const record& item) {
+	double seconds = item.timeNs * 1e-9;
+	const char* ellipsis = item.truncated ? "..." : "";
+	int length = static_cast<int>(item.length);
+
+	if (outputFormat == format::text) {
+		std::fprintf(stdout, "[%11.6f] %-5s t%-2u %.*s%s\n", seconds, to_string(item.level), item.thread, length, item.text, ellipsis);
+		return;
+	}
+
+	std::fprintf(stdout, "{\"t\":%.6f,\"level\":\"%s\",\"thread\":%u,\"msg\":\"", seconds, to_string(item.level), item.thread);
+	for (int i = 0; i < length; i++) {
+		char c = item.text[i];
+		if (c == '"' || c == '\\') {
+			std::fputc('\\', stdout);
+			std::fputc(c, stdout);
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			std::fprintf(stdout, "\\u%04x", c);
+		}
+		else {
+			std::fputc(c, stdout);
+		}
+	}
+	std::fprintf(stdout, "%s\"}\n", ellipsis);
+}
@@ -0,0 +1,67 @@
+#include "tiny_obj_loader.h"
+#include "mesh.h"
+#include <unordered_map>
+
+mesh buildMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes) {
+	mesh m;
+	std::unordered_map<Vertex, uint32_t> uniqueVertices;
+
+	size_t indexCount = 0;
+	for (const auto& shape : shapes) {
+		indexCount += shape.mesh.indices.size();
+	}
+	m.indices.reserve(indexCount);
+	uniqueVertices.reserve(indexCount / 3);
+
+	for (const auto& shape : shapes) {
+		for (size_t i = 0; i < shape.mesh.indices.size(); i++) {
+			const auto& index = shape.mesh.indices[i];
+
+			// a new submesh starts with every shape and every usemtl switch inside it
+			int materialId = shape.mesh.material_ids.empty() ? -1 : shape.mesh.material_ids[i / 3];
+			if (i == 0 || materialId != m.submeshes.back().materialId) {
+				submesh sm{
+					.firstIndex = static_cast<uint32_t>(m.indices.size()),
+					.indexCount = 0,
+					.materialId = materialId,
+					.nameOffset = static_cast<uint32_t>(m.names.size())
+				};
+				m.submeshes.push_back(sm);
+				m.names.insert(m.names.end(), shape.name.begin(), shape.name.end());
+				m.names.push_back('\0');
+			}
+			m.submeshes.back().indexCount++;
+
+			Vertex vertex{};
+
+			vertex.pos = {
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2]
+			};
+
+			if (index.normal_index >= 0) {
+				vertex.normal = {
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2]
+				};
+			}
+
+			if (index.texcoord_index >= 0) {
+				vertex.texCoord = {
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					attrib.texcoords[2 * index.texcoord_index + 1]
+				};
+			}
+
+			auto [it, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(m.vertices.size()));
+			if (inserted) {
+				m.vertices.push_back(vertex);
+			}
+			m.indices.push_back(it->second);
+		}
+	}
+
+	return m;
+}
@@ -0,0 +1,212 @@
+#include "meshcache.h"
+#include "log.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+	const uint64_t blobAlignment = 16;
+
+	uint64_t alignBlob(uint64_t offset) {
+		return (offset + blobAlignment - 1) & ~(blobAlignment - 1);
+	}
+
+	// path, mtime and the source's contents; hashing the mapped OBJ costs a fraction of parsing it
+	bool sourceKey(const std::string& sourcePath, uint64_t& key) {
+		std::error_code ec;
+		auto mtime = std::filesystem::last_write_time(sourcePath, ec);
+		if (ec) {
+			return false;
+		}
+		mappedFile source;
+		if (!source.open(sourcePath)) {
+			return false;
+		}
+		int64_t ticks = mtime.time_since_epoch().count();
+
+		key = hashBytes(sourcePath.data(), sourcePath.size());
+		key = hashBytes(&ticks, sizeof(ticks), key);
+		key = hashBytes(source.data, source.size, key);
+		return true;
+	}
+
+	bool rangeFits(uint32_t first, uint32_t count, uint32_t total) {
+		return uint64_t(first) + count <= total;
+	}
+
+	// a key match only says the cache was written for this source; a damaged file must still not
+	// send any table past the blobs it indexes
+	bool validView(const meshView& view, const char* names, uint64_t namesSize) {
+		if (namesSize && names[namesSize - 1] != '\0') {
+			return false;
+		}
+		for (uint32_t i = 0; i < view.submeshCount; i++) {
+			const submesh& part = view.submeshes[i];
+			if (!rangeFits(part.firstIndex, part.indexCount, view.indexCount)
+				|| !rangeFits(part.firstMeshlet, part.meshletCount, view.meshletCount)
+				|| !rangeFits(part.firstLod, part.lodCount, view.lodCount)
+				|| (part.nameOffset && part.nameOffset >= namesSize)) {
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < view.meshletCount; i++) {
+			const meshlet& ml = view.meshlets[i];
+			if (!rangeFits(ml.firstIndex, ml.indexCount, view.indexCount) || ml.submesh >= view.submeshCount) {
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < view.lodCount; i++) {
+			if (!rangeFits(view.lods[i].firstIndex, view.lods[i].indexCount, view.indexCount)) {
+				return false;
+			}
+		}
+
+		uint32_t maxIndex = 0;
+		if (view.indexSize == sizeof(uint16_t)) {
+			const uint16_t* indices = static_cast<const uint16_t*>(view.indices);
+			for (uint32_t i = 0; i < view.indexCount; i++) {
+				maxIndex = std::max<uint32_t>(maxIndex, indices[i]);
+			}
+		}
+		else {
+			const uint32_t* indices = static_cast<const uint32_t*>(view.indices);
+			for (uint32_t i = 0; i < view.indexCount; i++) {
+				maxIndex = std::max(maxIndex, indices[i]);
+			}
+		}
+		return view.indexCount == 0 || maxIndex < view.vertexCount;
+	}
+
+	// describes the Vertex struct this binary was compiled with
+	void fillLayout(meshCacheHeader& header) {
+		header.vertexStride = sizeof(Vertex);
+		header.attributeCount = 3;
+		header.attributes[0] = { vertexSemantic::position, 3, offsetof(Vertex, pos) };
+		header.attributes[1] = { vertexSemantic::normal, 3, offsetof(Vertex, normal) };
+		header.attributes[2] = { vertexSemantic::texCoord, 2, offsetof(Vertex, texCoord) };
+		header.attributes[3] = {};
+	}
+}
+
+const char* cachedMesh::submeshName(const submesh& sm) const {
+	return names ? names + sm.nameOffset : "";
+}
+
+std::string meshCachePath(const std::string& sourcePath) {
+	return sourcePath + ".r2em";
+}
+
+bool loadMeshCache(const std::string& sourcePath, cachedMesh& out) {
+	uint64_t key;
+	if (!sourceKey(sourcePath, key)) {
+		return false;
+	}
+
+	mappedFile file;
+	if (!file.open(meshCachePath(sourcePath)) || file.size < sizeof(meshCacheHeader)) {
+		return false;
+	}
+
+	meshCacheHeader header;
+	memcpy(&header, file.data, sizeof(header));
+
+	meshCacheHeader expected{};
+	fillLayout(expected);
+
+	if (header.magic != meshCacheMagic || header.version != meshCacheVersion || header.key != key) {
+		return false;
+	}
+	if (header.vertexStride != expected.vertexStride || header.attributeCount != expected.attributeCount ||
+		memcmp(header.attributes, expected.attributes, sizeof(header.attributes)) != 0) {
+		return false;
+	}
+	if (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) {
+		return false;
+	}
+
+	uint64_t vertexEnd = header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride;
+	uint64_t indexEnd = header.indexOffset + uint64_t(header.indexCount) * header.indexSize;
+	uint64_t submeshEnd = header.submeshOffset + uint64_t(header.submeshCount) * sizeof(submesh);
+	uint64_t namesEnd = header.namesOffset + header.namesSize;
+	uint64_t meshletEnd = header.meshletOffset + uint64_t(header.meshletCount) * sizeof(meshlet);
+	uint64_t lodEnd = header.lodOffset + uint64_t(header.lodCount) * sizeof(meshLod);
+	if (vertexEnd > file.size || indexEnd > file.size || submeshEnd > file.size || namesEnd > file.size
+		|| meshletEnd > file.size || lodEnd > file.size) {
+		return false;
+	}
+
+	meshView view = {
+		reinterpret_cast<const Vertex*>(file.data + header.vertexOffset), header.vertexCount,
+		file.data + header.indexOffset, header.indexCount, header.indexSize,
+		reinterpret_cast<const submesh*>(file.data + header.submeshOffset), header.submeshCount,
+		reinterpret_cast<const meshlet*>(file.data + header.meshletOffset), header.meshletCount,
+		reinterpret_cast<const meshLod*>(file.data + header.lodOffset), header.lodCount
+	};
+	const char* names = header.namesSize ? reinterpret_cast<const char*>(file.data + header.namesOffset) : nullptr;
+	if (!validView(view, names, header.namesSize)) {
+		LOG_WARN("mesh cache damaged, rebuilding: " << meshCachePath(sourcePath));
+		return false;
+	}
+
+	out.view = view;
+	out.names = names;
+	out.file = std::move(file);
+
+	LOG_INFO("mesh cache loaded: " << meshCachePath(sourcePath));
+
+	return true;
+}
+
+bool writeMeshCache(const std::string& sourcePath, const mesh& m) {
+	meshCacheHeader header{};
+	if (!sourceKey(sourcePath, header.key)) {
+		return false;
+	}
+	header.magic = meshCacheMagic;
+	header.version = meshCacheVersion;
+	fillLayout(header);
+
+	header.vertexCount = static_cast<uint32_t>(m.vertices.size());
+	header.indexCount = static_cast<uint32_t>(m.indices.size());
+	header.indexSize = m.compactIndices() ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.submeshCount = static_cast<uint32_t>(m.submeshes.size());
+	header.namesSize = m.names.size();
+	header.meshletCount = static_cast<uint32_t>(m.meshlets.size());
+	header.lodCount = static_cast<uint32_t>(m.lods.size());
+
+	header.vertexOffset = alignBlob(sizeof(header));
+	header.indexOffset = alignBlob(header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride);
+	header.submeshOffset = alignBlob(header.indexOffset + uint64_t(header.indexCount) * header.indexSize);
+	header.namesOffset = alignBlob(header.submeshOffset + uint64_t(header.submeshCount) * sizeof(submesh));
+	header.meshletOffset = alignBlob(header.namesOffset + header.namesSize);
+	header.lodOffset = alignBlob(header.meshletOffset + uint64_t(header.meshletCount) * sizeof(meshlet));
+
+	std::vector<uint8_t> blob(header.lodOffset + uint64_t(header.lodCount) * sizeof(meshLod));
+	memcpy(blob.data(), &header, sizeof(header));
+	memcpy(blob.data() + header.vertexOffset, m.vertices.data(), m.vertices.size() * sizeof(Vertex));
+
+	if (header.indexSize == sizeof(uint16_t)) {
+		uint16_t* dst = reinterpret_cast<uint16_t*>(blob.data() + header.indexOffset);
+		for (size_t i = 0; i < m.indices.size(); i++) {
+			dst[i] = static_cast<uint16_t>(m.indices[i]);
+		}
+	}
+	else {
+		memcpy(blob.data() + header.indexOffset, m.indices.data(), m.indices.size() * sizeof(uint32_t));
+	}
+
+	memcpy(blob.data() + header.submeshOffset, m.submeshes.data(), m.submeshes.size() * sizeof(submesh));
+	memcpy(blob.data() + header.namesOffset, m.names.data(), m.names.size());
+	memcpy(blob.data() + header.meshletOffset, m.meshlets.data(), m.meshlets.size() * sizeof(meshlet));
+	memcpy(blob.data() + header.lodOffset, m.lods.data(), m.lods.size() * sizeof(meshLod));
+
+	std::string path = meshCachePath(sourcePath);
+	if (!writeFileAtomic(path, blob.data(), blob.size())) {
+		return false;
+	}
+
+	LOG_INFO("mesh cache written: " << path);
+
+	return true;
+}
@@ -0,0 +1,231 @@
+#include "meshlet.h"
+#include "log.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// below this spread the cone is too wide to ever cull
+	const float minConeSpread = 0.1f;
+
+	// the pipeline draws clockwise triangles as front faces (FrontFace::eClockwise with a flipped
+	// viewport), so the normal pointing towards the viewer is cross(c - a, b - a)
+	glm::vec3 outwardNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		return glm::cross(c - a, b - a);
+	}
+
+	void computeBounds(meshlet& ml, const mesh& m) {
+		const uint32_t* indices = m.indices.data() + ml.firstIndex;
+
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		glm::vec3 normalSum(0.0f);
+		for (uint32_t i = 0; i < ml.indexCount; i += 3) {
+			const glm::vec3& a = m.vertices[indices[i + 0]].pos;
+			const glm::vec3& b = m.vertices[indices[i + 1]].pos;
+			const glm::vec3& c = m.vertices[indices[i + 2]].pos;
+			lo = glm::min(lo, glm::min(a, glm::min(b, c)));
+			hi = glm::max(hi, glm::max(a, glm::max(b, c)));
+
+			glm::vec3 n = outwardNormal(a, b, c);
+			float length = glm::length(n);
+			if (length > 0.0f) {
+				normalSum += n / length;
+			}
+		}
+
+		ml.center = (lo + hi) * 0.5f;
+		float radius2 = 0.0f;
+		for (uint32_t i = 0; i < ml.indexCount; i++) {
+			glm::vec3 d = m.vertices[indices[i]].pos - ml.center;
+			radius2 = std::max(radius2, glm::dot(d, d));
+		}
+		ml.radius = std::sqrt(radius2);
+
+		// every face normal lies within acos(minDot) of the axis, so all of them face away from any view
+		// direction within 90 degrees minus that of it
+		float sumLength = glm::length(normalSum);
+		if (sumLength == 0.0f) {
+			return;
+		}
+		ml.coneAxis = normalSum / sumLength;
+
+		float minDot = 1.0f;
+		for (uint32_t i = 0; i < ml.indexCount; i += 3) {
+			const glm::vec3& a = m.vertices[indices[i + 0]].pos;
+			const glm::vec3& b = m.vertices[indices[i + 1]].pos;
+			const glm::vec3& c = m.vertices[indices[i + 2]].pos;
+			glm::vec3 n = outwardNormal(a, b, c);
+			float length = glm::length(n);
+			if (length > 0.0f) {
+				minDot = std::min(minDot, glm::dot(n / length, ml.coneAxis));
+			}
+		}
+		if (minDot > minConeSpread) {
+			ml.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	// Gribb-Hartmann on glm's column-major matrices, with Vulkan's 0..w depth range
+	void extractPlanes(meshletCullView& view, const glm::mat4& m) {
+		glm::vec4 row[4];
+		for (int r = 0; r < 4; r++) {
+			row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+		}
+		view.planes[0] = row[3] + row[0];
+		view.planes[1] = row[3] - row[0];
+		view.planes[2] = row[3] + row[1];
+		view.planes[3] = row[3] - row[1];
+		view.planes[4] = row[2];
+		view.planes[5] = row[3] - row[2];
+
+		for (glm::vec4& p : view.planes) {
+			float length = glm::length(glm::vec3(p));
+			p = length > 0.0f ? p / length : glm::vec4(0.0f);
+		}
+	}
+}
+
+meshletCullView meshletCullView::fromPerspective(const glm::mat4& viewProj, glm::vec3 eye) {
+	meshletCullView view;
+	extractPlanes(view, viewProj);
+	view.eye = eye;
+	return view;
+}
+
+meshletCullView meshletCullView::fromOrthographic(const glm::mat4& viewProj, glm::vec3 forward) {
+	meshletCullView view;
+	extractPlanes(view, viewProj);
+	view.forward = glm::normalize(forward);
+	view.orthographic = true;
+	return view;
+}
+
+void buildMeshlets(mesh& m, uint32_t maxTriangles) {
+	m.meshlets.clear();
+
+	// a vertex belongs to the open meshlet while its stamp is that meshlet's index
+	std::vector<uint32_t> stamp(m.vertices.size(), UINT32_MAX);
+
+	for (uint32_t s = 0; s < m.submeshes.size(); s++) {
+		submesh& part = m.submeshes[s];
+		part.firstMeshlet = static_cast<uint32_t>(m.meshlets.size());
+
+		uint32_t end = part.firstIndex + part.indexCount;
+		meshlet open{ .firstIndex = part.firstIndex, .indexCount = 0, .vertexCount = 0, .submesh = s };
+		uint32_t id = static_cast<uint32_t>(m.meshlets.size());
+
+		for (uint32_t i = part.firstIndex; i + 2 < end; i += 3) {
+			if (open.indexCount / 3 == maxTriangles) {
+				computeBounds(open, m);
+				m.meshlets.push_back(open);
+				open = { .firstIndex = i, .indexCount = 0, .vertexCount = 0, .submesh = s };
+				id++;
+			}
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = m.indices[i + k];
+				if (stamp[v] != id) {
+					stamp[v] = id;
+					open.vertexCount++;
+				}
+			}
+			open.indexCount += 3;
+		}
+		if (open.indexCount) {
+			computeBounds(open, m);
+			m.meshlets.push_back(open);
+		}
+
+		part.meshletCount = static_cast<uint32_t>(m.meshlets.size()) - part.firstMeshlet;
+	}
+}
+
+bool meshletVisible(const meshlet& ml, const meshletCullView& view) {
+	for (const glm::vec4& p : view.planes) {
+		if (glm::dot(glm::vec3(p), ml.center) + p.w < -ml.radius) {
+			return false;
+		}
+	}
+
+	if (ml.coneCutoff >= 1.0f) {
+		return true;
+	}
+	if (view.orthographic) {
+		return glm::dot(view.forward, ml.coneAxis) < ml.coneCutoff;
+	}
+	glm::vec3 toCenter = ml.center - view.eye;
+	return glm::dot(toCenter, ml.coneAxis) < ml.coneCutoff * glm::length(toCenter) + ml.radius;
+}
+
+namespace {
+	// n x n quads in the z = 0 plane over [-0.5, 0.5] shifted by offset; clockwise on screen seen from +z
+	// with y up, which is how the pipeline draws front faces
+	mesh makeGrid(uint32_t n, glm::vec3 offset, bool frontFacing) {
+		mesh grid;
+		for (uint32_t y = 0; y <= n; y++) {
+			for (uint32_t x = 0; x <= n; x++) {
+				glm::vec3 pos(float(x) / n - 0.5f, float(y) / n - 0.5f, 0.0f);
+				grid.vertices.push_back({ pos + offset, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(pos) });
+			}
+		}
+		for (uint32_t y = 0; y < n; y++) {
+			for (uint32_t x = 0; x < n; x++) {
+				uint32_t p00 = y * (n + 1) + x, p10 = p00 + 1, p01 = p00 + n + 1, p11 = p01 + 1;
+				uint32_t triangles[2][3] = { { p00, p01, p10 }, { p10, p01, p11 } };
+				for (auto& t : triangles) {
+					if (!frontFacing) {
+						std::swap(t[1], t[2]);
+					}
+					grid.indices.insert(grid.indices.end(), t, t + 3);
+				}
+			}
+		}
+		grid.submeshes.push_back({ .firstIndex = 0, .indexCount = static_cast<uint32_t>(grid.indices.size()),
+			.materialId = -1, .nameOffset = 0 });
+		buildMeshlets(grid);
+		return grid;
+	}
+
+	uint32_t countVisible(const mesh& m, const meshletCullView& view) {
+		uint32_t visible = 0;
+		for (const meshlet& ml : m.meshlets) {
+			visible += meshletVisible(ml, view);
+		}
+		return visible;
+	}
+}
+
+bool meshletSelfTest(const glm::mat4& viewProj, glm::vec3 forward) {
+	bool passed = true;
+	auto check = [&](bool condition, const char* what) {
+		if (!condition) {
+			LOG_ERROR("meshlet self-test failed: " << what);
+			passed = false;
+		}
+	};
+
+	mesh front = makeGrid(16, glm::vec3(0.0f), true);
+	mesh back = makeGrid(16, glm::vec3(0.0f), false);
+	mesh aside = makeGrid(16, glm::vec3(3.0f, 0.0f, 0.0f), true);
+	uint32_t count = static_cast<uint32_t>(front.meshlets.size());
+	check(count == (16 * 16 * 2 + 123) / 124, "grids split at 124 triangles");
+	check(std::all_of(front.meshlets.begin(), front.meshlets.end(), [](const meshlet& ml) {
+		return ml.coneCutoff < 1.0f && ml.coneAxis.z > 0.99f;
+	}), "a flat grid's cone points out of its clockwise faces");
+
+	meshletCullView ortho = meshletCullView::fromOrthographic(viewProj, forward);
+	check(countVisible(front, ortho) == count, "front-facing meshlets survive the renderer's view");
+	check(countVisible(back, ortho) == 0, "back-facing meshlets are culled in the renderer's view");
+	check(countVisible(aside, ortho) == 0, "meshlets outside the renderer's view are culled");
+
+	glm::vec3 eye(0.0f, 0.0f, 2.0f);
+	glm::mat4 perspective = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 10.0f)
+		* glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	meshletCullView fromEye = meshletCullView::fromPerspective(perspective, eye);
+	check(countVisible(front, fromEye) == count, "front-facing meshlets survive a perspective eye");
+	check(countVisible(back, fromEye) == 0, "back-facing meshlets are culled from a perspective eye");
+
+	if (passed) {
+		LOG_INFO("meshlet self-test passed: " << count << " meshlets per grid");
+	}
+	return passed;
+}
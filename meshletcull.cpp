@@ -0,0 +1,172 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "meshletcull.h"
+#include "log.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+using namespace vk;
+
+static_assert(sizeof(meshlet) == 48, "cull.comp reads meshlets as 48-byte std430 structs");
+static_assert(sizeof(meshletCullSubmesh) == 12, "cull.comp reads submesh states as 12-byte std430 structs");
+
+bool meshletCullPass::init(Device dev, const PhysicalDeviceLimits& limits, PipelineCache cache, shaderRegistry& shaders,
+	layoutCache& layouts, uint32_t framesInFlight) {
+	device = dev;
+	storageAlignment = std::max<DeviceSize>(limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+
+	shaderReflection reflection;
+	ShaderModule module = shaders.load("shaders/cull.spv", &reflection);
+	if (!module) {
+		LOG_WARN("meshlet culling stays on the CPU: shaders/cull.spv is missing or invalid");
+		return false;
+	}
+
+	// the meshlet table, the submesh states and the commands, in that order, and the view
+	bool matches = reflection.stage == ShaderStageFlagBits::eCompute && reflection.bindings.size() == 3
+		&& reflection.pushConstants.size() == 1 && reflection.pushConstants[0].offset == 0
+		&& reflection.pushConstants[0].size == offsetof(pushView, meshletCount) + sizeof(uint32_t);
+	for (uint32_t i = 0; matches && i < 3; i++) {
+		const reflectedBinding& b = reflection.bindings[i];
+		matches = b.set == 0 && b.binding == i && b.type == DescriptorType::eStorageBuffer && b.count == 1;
+	}
+	if (!matches) {
+		LOG_WARN("meshlet culling stays on the CPU: shaders/cull.spv does not match cull.comp's interface");
+		return false;
+	}
+
+	// the same bindings pipelineLayout builds, so the cache hands back the layout it used
+	std::vector<DescriptorSetLayoutBinding> bindings;
+	for (const reflectedBinding& b : reflection.bindings) {
+		bindings.push_back({ .binding = b.binding,
+		.descriptorType = b.type,
+		.descriptorCount = b.count,
+		.stageFlags = b.stages });
+	}
+	layout = layouts.pipelineLayout({ &reflection });
+	DescriptorSetLayout setLayout = layouts.setLayout(bindings);
+
+	DescriptorPoolSize poolSize{ .type = DescriptorType::eStorageBuffer, .descriptorCount = 3 * framesInFlight };
+	DescriptorPoolCreateInfo poolCi{ .maxSets = framesInFlight,
+	.poolSizeCount = 1,
+	.pPoolSizes = &poolSize };
+	pool = device.createDescriptorPool(poolCi);
+
+	std::vector<DescriptorSetLayout> setLayouts(framesInFlight, setLayout);
+	DescriptorSetAllocateInfo setInfo{ .descriptorPool = pool,
+	.descriptorSetCount = framesInFlight,
+	.pSetLayouts = setLayouts.data() };
+	std::vector<DescriptorSet> sets = device.allocateDescriptorSets(setInfo);
+	slots.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		slots[i].set = sets[i];
+	}
+
+	ComputePipelineCreateInfo ci{ .stage = {.stage = ShaderStageFlagBits::eCompute, .module = module, .pName = "main" },
+	.layout = layout };
+	Result result;
+	Pipeline created;
+	std::tie(result, created) = device.createComputePipeline(cache, ci);
+	if (result != Result::eSuccess) {
+		LOG_WARN("meshlet culling stays on the CPU: compute pipeline creation failed: " << to_string(result));
+		if (created) {
+			device.destroyPipeline(created);
+		}
+		destroy();
+		return false;
+	}
+	pipeline = created;
+
+	LOG_INFO("meshlet culling runs in a compute pass");
+	return true;
+}
+
+void meshletCullPass::destroy() {
+	if (pipeline) {
+		device.destroyPipeline(pipeline);
+		pipeline = nullptr;
+	}
+	if (pool) {
+		device.destroyDescriptorPool(pool);
+		pool = nullptr;
+	}
+	slots.clear();
+}
+
+meshletCullSubmesh* meshletCullPass::begin(uint32_t slot, transientBuffer& transient, Buffer meshlets,
+	const meshletCullView& view, uint32_t submeshCount, uint32_t meshletCount) {
+	frameSlot& frame = slots[slot];
+	frame.meshletCount = 0;
+
+	DeviceSize statesOffset, commandsOffset;
+	void* states;
+	void* commands;
+	DeviceSize statesSize = sizeof(meshletCullSubmesh) * submeshCount;
+	DeviceSize commandsSize = sizeof(DrawIndexedIndirectCommand) * meshletCount;
+	if (!transient.allocate(statesSize, storageAlignment, statesOffset, states)
+		|| !transient.allocate(commandsSize, storageAlignment, commandsOffset, commands)) {
+		return nullptr;
+	}
+	std::memset(states, 0, statesSize);
+
+	DescriptorBufferInfo buffers[] = {
+		{ .buffer = meshlets, .offset = 0, .range = sizeof(meshlet) * meshletCount },
+		{ .buffer = transient.buffer, .offset = statesOffset, .range = statesSize },
+		{ .buffer = transient.buffer, .offset = commandsOffset, .range = commandsSize } };
+	WriteDescriptorSet writes[3];
+	for (uint32_t i = 0; i < 3; i++) {
+		writes[i] = { .dstSet = frame.set,
+		.dstBinding = i,
+		.descriptorCount = 1,
+		.descriptorType = DescriptorType::eStorageBuffer,
+		.pBufferInfo = &buffers[i] };
+	}
+	device.updateDescriptorSets(writes, nullptr);
+
+	for (int i = 0; i < 6; i++) {
+		frame.view.planes[i] = view.planes[i];
+	}
+	frame.view.viewer = view.orthographic ? glm::vec4(view.forward, 1.0f) : glm::vec4(view.eye, 0.0f);
+	frame.view.meshletCount = meshletCount;
+	frame.commands = commandsOffset;
+	frame.meshletCount = meshletCount;
+	return static_cast<meshletCullSubmesh*>(states);
+}
+
+DeviceSize meshletCullPass::commandOffset(uint32_t slot, uint32_t index) const {
+	return slots[slot].commands + sizeof(DrawIndexedIndirectCommand) * index;
+}
+
+void meshletCullPass::record(CommandBuffer cmd, uint32_t slot) {
+	const frameSlot& frame = slots[slot];
+	if (frame.meshletCount == 0) {
+		return;
+	}
+
+	cmd.bindPipeline(PipelineBindPoint::eCompute, pipeline);
+	cmd.bindDescriptorSets(PipelineBindPoint::eCompute, layout, 0, frame.set, nullptr);
+	cmd.pushConstants(layout, ShaderStageFlagBits::eCompute, 0, offsetof(pushView, meshletCount) + sizeof(uint32_t),
+		&frame.view);
+	cmd.dispatch((frame.meshletCount + groupSize - 1) / groupSize, 1, 1);
+
+	MemoryBarrier toIndirect{ .srcAccessMask = AccessFlagBits::eShaderWrite, .dstAccessMask = AccessFlagBits::eIndirectCommandRead };
+	cmd.pipelineBarrier(PipelineStageFlagBits::eComputeShader, PipelineStageFlagBits::eDrawIndirect, {}, toIndirect,
+		nullptr, nullptr);
+}
+
+bool meshletCullPass::results(uint32_t slot, const transientBuffer& transient, uint32_t& visible, uint32_t& triangles) const {
+	if (slot >= slots.size() || slots[slot].meshletCount == 0) {
+		return false;
+	}
+	const frameSlot& frame = slots[slot];
+	const auto* commands = reinterpret_cast<const DrawIndexedIndirectCommand*>(
+		static_cast<const uint8_t*>(transient.memory.mapped) + frame.commands);
+	for (uint32_t i = 0; i < frame.meshletCount; i++) {
+		if (commands[i].instanceCount) {
+			visible++;
+			triangles += commands[i].indexCount / 3;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,332 @@
+#include "meshopt.h"
+#include <algorithm>
+#include <numeric>
+
+vertexCacheStats simulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+	vertexCacheStats stats;
+	if (indexCount < 3) {
+		return stats;
+	}
+
+	// a vertex is cached while fewer than cacheSize misses happened since it was inserted
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t clock = cacheSize + 1;
+	uint32_t unique = 0;
+
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t v = indices[i];
+		if (!referenced[v]) {
+			referenced[v] = true;
+			unique++;
+		}
+		if (clock - insertedAt[v] > cacheSize) {
+			insertedAt[v] = clock++;
+			stats.misses++;
+		}
+	}
+
+	stats.acmr = float(stats.misses) / float(indexCount / 3);
+	stats.atvr = unique ? float(stats.misses) / float(unique) : 0.0f;
+	return stats;
+}
+
+namespace {
+	// triangles around every vertex, as offsets into one flat list
+	struct adjacency {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		adjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+			: offsets(vertexCount + 1, 0), triangles(indexCount) {
+			for (size_t i = 0; i < indexCount; i++) {
+				offsets[indices[i] + 1]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indexCount; i++) {
+				triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+	};
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	adjacency adj(indices, indexCount, vertexCount);
+	// triangles still to be emitted around each vertex
+	std::vector<uint32_t> live(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		live[v] = adj.offsets[v + 1] - adj.offsets[v];
+	}
+
+	std::vector<uint32_t> cachedAt(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	uint32_t clock = cacheSize + 1;
+	size_t cursor = 0;
+	int64_t fanning = indices[0];
+
+	while (fanning >= 0) {
+		uint32_t f = static_cast<uint32_t>(fanning);
+		candidates.clear();
+
+		// emit every remaining triangle around the fanning vertex
+		for (uint32_t a = adj.offsets[f]; a < adj.offsets[f + 1]; a++) {
+			uint32_t t = adj.triangles[a];
+			if (emitted[t]) {
+				continue;
+			}
+			emitted[t] = true;
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (clock - cachedAt[v] > cacheSize) {
+					cachedAt[v] = clock++;
+				}
+			}
+		}
+
+		// next fan: the candidate that will still be cached after its remaining triangles are emitted,
+		// preferring the one that has been in the cache longest
+		fanning = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0) {
+				continue;
+			}
+			int64_t priority = 0;
+			if (clock - cachedAt[v] + 2 * live[v] <= cacheSize) {
+				priority = clock - cachedAt[v];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+
+		if (fanning < 0) {
+			// dead end: fall back to recently used vertices, then to input order
+			while (!deadEnd.empty()) {
+				uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0) {
+					fanning = v;
+					break;
+				}
+			}
+			while (fanning < 0 && cursor < indexCount) {
+				uint32_t v = indices[cursor++];
+				if (live[v] > 0) {
+					fanning = v;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+namespace {
+	// a handful of triangles per cluster keeps the sort meaningful
+	const size_t minClusterSize = 8;
+
+	// clusters ordered so outward-facing ones far from the centre come first; clusters holds the first
+	// triangle of every cluster plus the triangle count
+	std::vector<uint32_t> sortClusters(const uint32_t* indices, size_t indexCount, const Vertex* vertices,
+		const std::vector<size_t>& clusters) {
+		size_t clusterCount = clusters.size() - 1;
+		std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+		std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+
+		// area-weighted centroid and normal of each cluster and of the whole mesh
+		for (size_t c = 0; c < clusterCount; c++) {
+			float area = 0.0f;
+			for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+				const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+				const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+				const glm::vec3& d = vertices[indices[t * 3 + 2]].pos;
+				glm::vec3 n = glm::cross(b - a, d - a);
+				float w = glm::length(n);
+				centroids[c] += (a + b + d) * (w / 3.0f);
+				normals[c] += n;
+				area += w;
+			}
+			meshCentroid += centroids[c];
+			meshArea += area;
+			if (area > 0.0f) {
+				centroids[c] /= area;
+			}
+		}
+		if (meshArea > 0.0f) {
+			meshCentroid /= meshArea;
+		}
+
+		std::vector<float> keys(clusterCount);
+		for (size_t c = 0; c < clusterCount; c++) {
+			float length = glm::length(normals[c]);
+			keys[c] = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		for (uint32_t c : order) {
+			output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+		}
+		return output;
+	}
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	float threshold, uint32_t cacheSize) {
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	std::vector<uint32_t> insertedAt(vertexCount, 0);
+	uint32_t clock = cacheSize + 1;
+	auto missesFor = [&](size_t t) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			if (clock - insertedAt[v] > cacheSize) {
+				insertedAt[v] = clock++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// hard boundaries: a triangle missing all three vertices is where the cache order jumped anyway;
+	// meshes with many seams jump constantly, so tiny clusters are merged into the next one
+	std::vector<size_t> hard{ 0 };
+	uint32_t inputMisses = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		uint32_t misses = missesFor(t);
+		inputMisses += misses;
+		if (misses == 3 && t - hard.back() >= minClusterSize) {
+			hard.push_back(t);
+		}
+	}
+	hard.push_back(triangleCount);
+
+	// soft boundaries: cut a hard cluster wherever the part so far, starting from a cold cache, already
+	// caches within threshold of the cluster as a whole
+	std::vector<size_t> soft;
+	for (size_t h = 0; h + 1 < hard.size(); h++) {
+		size_t start = hard[h], end = hard[h + 1];
+
+		clock += cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (size_t t = start; t < end; t++) {
+			clusterMisses += missesFor(t);
+		}
+		float target = threshold * float(clusterMisses) / float(end - start);
+
+		clock += cacheSize + 1;
+		soft.push_back(start);
+		uint32_t misses = 0;
+		size_t first = start;
+		for (size_t t = start; t < end; t++) {
+			misses += missesFor(t);
+			size_t count = t - first + 1;
+			if (t + 1 < end && count >= minClusterSize && float(misses) / float(count) <= target) {
+				soft.push_back(t + 1);
+				first = t + 1;
+				misses = 0;
+				clock += cacheSize + 1;
+			}
+		}
+	}
+	soft.push_back(triangleCount);
+
+	// every cluster restarts the cache once reordered; on meshes where that costs more than threshold
+	// allows, fall back to the coarser hard clusters, then to the input order
+	float limit = threshold * float(inputMisses);
+	for (const auto* clusters : { &soft, &hard }) {
+		std::vector<uint32_t> output = sortClusters(indices, indexCount, vertices, *clusters);
+		if (float(simulateVertexCache(output.data(), indexCount, vertexCount, cacheSize).misses) <= limit) {
+			std::copy(output.begin(), output.end(), indices);
+			return;
+		}
+	}
+}
+
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (auto& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(ordered);
+	return vertices.size();
+}
+
+meshOptimizeStats optimizeMesh(mesh& m) {
+	meshOptimizeStats stats;
+	stats.before = simulateVertexCache(m.indices.data(), m.indices.size(), m.vertices.size());
+
+	// each submesh is optimized on its own compact vertex numbering, so the per-vertex tables stay
+	// as small as the submesh
+	std::vector<uint32_t> owner(m.vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> local(m.vertices.size());
+	std::vector<uint32_t> global;
+	std::vector<Vertex> localVertices;
+	std::vector<uint32_t> localIndices;
+
+	for (uint32_t s = 0; s < m.submeshes.size(); s++) {
+		const submesh& part = m.submeshes[s];
+		uint32_t* range = m.indices.data() + part.firstIndex;
+
+		global.clear();
+		localVertices.clear();
+		localIndices.resize(part.indexCount);
+		for (uint32_t i = 0; i < part.indexCount; i++) {
+			uint32_t v = range[i];
+			if (owner[v] != s) {
+				owner[v] = s;
+				local[v] = static_cast<uint32_t>(global.size());
+				global.push_back(v);
+				localVertices.push_back(m.vertices[v]);
+			}
+			localIndices[i] = local[v];
+		}
+
+		optimizeVertexCache(localIndices.data(), localIndices.size(), global.size());
+		optimizeOverdraw(localIndices.data(), localIndices.size(), localVertices.data(), localVertices.size());
+
+		for (uint32_t i = 0; i < part.indexCount; i++) {
+			range[i] = global[localIndices[i]];
+		}
+	}
+
+	optimizeVertexFetch(m.vertices, m.indices);
+
+	stats.after = simulateVertexCache(m.indices.data(), m.indices.size(), m.vertices.size());
+	return stats;
+}
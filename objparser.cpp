@@ -0,0 +1,738 @@
+#include "tiny_obj_loader.h"
+#include "objparser.h"
+#include "util.h"
+#include "log.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+using namespace tinyobj;
+
+namespace {
+	// chunks are small enough to balance the pool but big enough to amortize bookkeeping
+	const size_t minChunkSize = 256 * 1024;
+
+	enum class objEventType : uint8_t {
+		object,
+		group,
+		material,
+		materialLib,
+		smoothing
+	};
+
+	// state change recorded at a face position inside a chunk
+	struct objEvent {
+		objEventType type;
+		uint32_t face;			// faces parsed in the chunk before the event
+		uint32_t triangles;		// triangles emitted in the chunk before the event
+		unsigned smoothingId;
+		std::string text;
+	};
+
+	// run of faces in one chunk that lands in a single shape with constant material
+	struct objSegment {
+		uint32_t faceBegin;
+		uint32_t faceEnd;
+		uint32_t shape;
+		uint32_t triangleOffset;	// first triangle inside the shape
+		int materialId;
+		unsigned smoothingId;
+	};
+
+	struct objChunk {
+		const char* begin;
+		const char* end;
+
+		std::vector<real_t> v, vt, vn, vc;
+		std::vector<int> corners;			// v, vt, vn per face corner
+		std::vector<uint8_t> relative;		// per corner, bit i set when corners[3 * c + i] is chunk-relative
+		std::vector<uint32_t> faceSizes;
+		uint32_t triangles = 0;
+		std::vector<objEvent> events;
+		std::vector<objSegment> segments;
+
+		size_t vBase = 0, vtBase = 0, vnBase = 0;
+		std::string error;
+	};
+
+	inline bool isSpace(char c) {
+		return c == ' ' || c == '\t';
+	}
+
+	inline char peek(const char* p, const char* end) {
+		return p < end ? *p : '\0';
+	}
+
+	inline bool startsWith(const char* p, const char* end, const char* keyword) {
+		size_t length = strlen(keyword);
+		return size_t(end - p) >= length && memcmp(p, keyword, length) == 0;
+	}
+
+	inline bool isLineEnd(const char* p, const char* end) {
+		return p >= end || *p == '\n' || *p == '\r';
+	}
+
+	inline const char* skipSpace(const char* p, const char* end) {
+		while (p < end && isSpace(*p)) {
+			p++;
+		}
+		return p;
+	}
+
+	bool parseReal(const char*& p, const char* end, real_t& out) {
+		p = skipSpace(p, end);
+		if (p < end && *p == '+') {
+			p++;
+		}
+		auto [next, ec] = std::from_chars(p, end, out);
+		if (ec != std::errc()) {
+			return false;
+		}
+		p = next;
+		return true;
+	}
+
+	// tinyobj's rule for v/vt/vn: each component is the next whitespace-separated token, read as far as
+	// it is a number; the token is consumed either way
+	bool parseToken(const char*& p, const char* end, real_t& out) {
+		p = skipSpace(p, end);
+		const char* tokenEnd = p;
+		while (!isLineEnd(tokenEnd, end) && !isSpace(*tokenEnd)) {
+			tokenEnd++;
+		}
+		const char* t = p;
+		p = tokenEnd;
+		return parseReal(t, tokenEnd, out);
+	}
+
+	// a component that is missing or does not start with a number takes the default
+	real_t parseComponent(const char*& p, const char* end, real_t fallback) {
+		real_t value;
+		return parseToken(p, end, value) ? value : fallback;
+	}
+
+	// mtllib names split at spaces, with backslash escaping the next character, as tinyobj splits them
+	std::vector<std::string> splitNames(const std::string& text) {
+		std::vector<std::string> names;
+		std::string name;
+		bool escaping = false;
+		for (char c : text) {
+			if (escaping) {
+				escaping = false;
+			}
+			else if (c == '\\') {
+				escaping = true;
+				continue;
+			}
+			else if (c == ' ') {
+				if (!name.empty()) {
+					names.push_back(name);
+				}
+				name.clear();
+				continue;
+			}
+			name += c;
+		}
+		names.push_back(name);
+		return names;
+	}
+
+	bool parseInt(const char*& p, const char* end, int& out) {
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+		if (p >= end || *p < '0' || *p > '9') {
+			return false;
+		}
+		int value = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			value = value * 10 + (*p - '0');
+			p++;
+		}
+		out = negative ? -value : value;
+		return true;
+	}
+
+	// OBJ indices are 1-based, negative ones count back from the current element count
+	bool resolveIndex(int raw, size_t localCount, int& out, bool& relative) {
+		if (raw > 0) {
+			out = raw - 1;
+			relative = false;
+			return true;
+		}
+		if (raw < 0) {
+			out = static_cast<int>(localCount) + raw;
+			relative = true;
+			return true;
+		}
+		return false;
+	}
+
+	std::string restOfLine(const char* p, const char* end) {
+		p = skipSpace(p, end);
+		const char* e = p;
+		while (!isLineEnd(e, end)) {
+			e++;
+		}
+		while (e > p && isSpace(e[-1])) {
+			e--;
+		}
+		return std::string(p, e);
+	}
+
+	bool parseFace(objChunk& chunk, const char* p, const char* end) {
+		uint32_t count = 0;
+		p = skipSpace(p, end);
+		while (!isLineEnd(p, end)) {
+			int raw[3] = { 0, 0, 0 };
+			if (!parseInt(p, end, raw[0])) {
+				return false;
+			}
+			if (p < end && *p == '/') {
+				p++;
+				if (p < end && *p != '/') {
+					if (!parseInt(p, end, raw[1])) {
+						return false;
+					}
+				}
+				if (p < end && *p == '/') {
+					p++;
+					if (!parseInt(p, end, raw[2])) {
+						return false;
+					}
+				}
+			}
+
+			size_t counts[3] = { chunk.v.size() / 3, chunk.vt.size() / 2, chunk.vn.size() / 3 };
+			uint8_t relativeBits = 0;
+			for (int i = 0; i < 3; i++) {
+				int index = -1;
+				bool relative = false;
+				if ((i == 0 || raw[i] != 0) && !resolveIndex(raw[i], counts[i], index, relative)) {
+					return false;
+				}
+				chunk.corners.push_back(index);
+				relativeBits |= relative ? uint8_t(1 << i) : uint8_t(0);
+			}
+			chunk.relative.push_back(relativeBits);
+			count++;
+
+			p = skipSpace(p, end);
+		}
+
+		chunk.faceSizes.push_back(count);
+		chunk.triangles += count >= 3 ? count - 2 : 0;
+		return true;
+	}
+
+	void addEvent(objChunk& chunk, objEventType type, std::string text, unsigned smoothingId = 0) {
+		chunk.events.push_back({ type, static_cast<uint32_t>(chunk.faceSizes.size()), chunk.triangles,
+			smoothingId, std::move(text) });
+	}
+
+	void parseChunk(objChunk& chunk) {
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+
+		while (p < end) {
+			const char* line = skipSpace(p, end);
+			const char* next = static_cast<const char*>(memchr(line, '\n', end - line));
+			next = next ? next + 1 : end;
+			p = next;
+
+			if (isLineEnd(line, end) || *line == '#') {
+				continue;
+			}
+
+			bool ok = true;
+			if (line[0] == 'v' && isSpace(peek(line + 1, end))) {
+				const char* t = line + 2;
+				real_t x = parseComponent(t, end, 0.0f);
+				real_t y = parseComponent(t, end, 0.0f);
+				real_t z = parseComponent(t, end, 0.0f);
+				chunk.v.insert(chunk.v.end(), { x, y, z });
+
+				// the color extension only counts when all three are there
+				real_t r = 1.0f, g = 1.0f, b = 1.0f;
+				if (!(parseToken(t, end, r) && parseToken(t, end, g) && parseToken(t, end, b))) {
+					r = g = b = 1.0f;
+				}
+				chunk.vc.insert(chunk.vc.end(), { r, g, b });
+			}
+			else if (startsWith(line, end, "vn") && isSpace(peek(line + 2, end))) {
+				const char* t = line + 3;
+				real_t x = parseComponent(t, end, 0.0f);
+				real_t y = parseComponent(t, end, 0.0f);
+				real_t z = parseComponent(t, end, 0.0f);
+				chunk.vn.insert(chunk.vn.end(), { x, y, z });
+			}
+			else if (startsWith(line, end, "vt") && isSpace(peek(line + 2, end))) {
+				const char* t = line + 3;
+				real_t u = parseComponent(t, end, 0.0f);
+				real_t v = parseComponent(t, end, 0.0f);
+				chunk.vt.insert(chunk.vt.end(), { u, v });
+			}
+			else if (line[0] == 'f' && isSpace(peek(line + 1, end))) {
+				ok = parseFace(chunk, line + 2, end);
+			}
+			else if (line[0] == 'o' && isSpace(peek(line + 1, end))) {
+				addEvent(chunk, objEventType::object, restOfLine(line + 2, end));
+			}
+			else if (line[0] == 'g' && isSpace(peek(line + 1, end))) {
+				// multiple group names collapse into one, separated by single spaces
+				std::string names = restOfLine(line + 2, end);
+				names.erase(std::unique(names.begin(), names.end(), [](char a, char b) {
+					return isSpace(a) && isSpace(b);
+				}), names.end());
+				std::replace(names.begin(), names.end(), '\t', ' ');
+				addEvent(chunk, objEventType::group, std::move(names));
+			}
+			else if (startsWith(line, end, "usemtl") && isSpace(peek(line + 6, end))) {
+				addEvent(chunk, objEventType::material, restOfLine(line + 6, end));
+			}
+			else if (startsWith(line, end, "mtllib") && isSpace(peek(line + 6, end))) {
+				addEvent(chunk, objEventType::materialLib, restOfLine(line + 6, end));
+			}
+			else if (line[0] == 's' && isSpace(peek(line + 1, end))) {
+				const char* t = skipSpace(line + 2, end);
+				int id = 0;
+				if (startsWith(t, end, "off") || !parseInt(t, end, id) || id < 0) {
+					id = 0;
+				}
+				addEvent(chunk, objEventType::smoothing, std::string(), static_cast<unsigned>(id));
+			}
+
+			if (!ok) {
+				chunk.error = "Failed to parse line: " + std::string(line, next);
+				return;
+			}
+		}
+	}
+
+	// splits [data, data + size) into roughly equal ranges ending on line boundaries
+	std::vector<objChunk> splitChunks(const char* data, size_t size, unsigned workers) {
+		size_t target = std::max(minChunkSize, size / (size_t(workers) * 4) + 1);
+		std::vector<objChunk> chunks;
+		const char* p = data;
+		const char* end = data + size;
+		while (p < end) {
+			const char* e = p + std::min(target, size_t(end - p));
+			if (e < end) {
+				const char* nl = static_cast<const char*>(memchr(e, '\n', end - e));
+				e = nl ? nl + 1 : end;
+			}
+			objChunk chunk;
+			chunk.begin = p;
+			chunk.end = e;
+			chunks.push_back(std::move(chunk));
+			p = e;
+		}
+		return chunks;
+	}
+
+	index_t corner(const objChunk& chunk, size_t c) {
+		size_t bases[3] = { chunk.vBase, chunk.vtBase, chunk.vnBase };
+		int resolved[3];
+		for (int i = 0; i < 3; i++) {
+			resolved[i] = chunk.corners[3 * c + i];
+			if (chunk.relative[c] & (1 << i)) {
+				resolved[i] += static_cast<int>(bases[i]);
+			}
+		}
+		index_t idx;
+		idx.vertex_index = resolved[0];
+		idx.texcoord_index = resolved[1];
+		idx.normal_index = resolved[2];
+		return idx;
+	}
+
+	real_t distanceSq(const std::vector<real_t>& v, int a, int b) {
+		real_t dx = v[3 * b + 0] - v[3 * a + 0];
+		real_t dy = v[3 * b + 1] - v[3 * a + 1];
+		real_t dz = v[3 * b + 2] - v[3 * a + 2];
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	// writes the segment's triangles at their precomputed place in the shape
+	void emitSegment(const objChunk& chunk, const objSegment& segment, const std::vector<uint32_t>& faceCorner,
+		const attrib_t& attrib, shape_t& shape) {
+		size_t tri = segment.triangleOffset;
+		auto emit = [&](const index_t& a, const index_t& b, const index_t& c) {
+			shape.mesh.indices[3 * tri + 0] = a;
+			shape.mesh.indices[3 * tri + 1] = b;
+			shape.mesh.indices[3 * tri + 2] = c;
+			shape.mesh.num_face_vertices[tri] = 3;
+			shape.mesh.material_ids[tri] = segment.materialId;
+			shape.mesh.smoothing_group_ids[tri] = segment.smoothingId;
+			tri++;
+		};
+
+		for (uint32_t f = segment.faceBegin; f < segment.faceEnd; f++) {
+			uint32_t n = chunk.faceSizes[f];
+			size_t first = faceCorner[f];
+			if (n < 3) {
+				continue;
+			}
+			index_t i0 = corner(chunk, first);
+			if (n == 4) {
+				// same split as tinyobj: cut along the shorter diagonal
+				index_t i1 = corner(chunk, first + 1);
+				index_t i2 = corner(chunk, first + 2);
+				index_t i3 = corner(chunk, first + 3);
+				if (distanceSq(attrib.vertices, i0.vertex_index, i2.vertex_index) <
+					distanceSq(attrib.vertices, i1.vertex_index, i3.vertex_index)) {
+					emit(i0, i1, i2);
+					emit(i0, i2, i3);
+				}
+				else {
+					emit(i0, i1, i3);
+					emit(i1, i2, i3);
+				}
+				continue;
+			}
+			for (uint32_t k = 1; k + 1 < n; k++) {
+				emit(i0, corner(chunk, first + k), corner(chunk, first + k + 1));
+			}
+		}
+	}
+
+	bool validateCorners(const objChunk& chunk, const attrib_t& attrib) {
+		int counts[3] = {
+			static_cast<int>(attrib.vertices.size() / 3),
+			static_cast<int>(attrib.texcoords.size() / 2),
+			static_cast<int>(attrib.normals.size() / 3)
+		};
+		for (size_t c = 0; c < chunk.relative.size(); c++) {
+			index_t idx = corner(chunk, c);
+			int resolved[3] = { idx.vertex_index, idx.texcoord_index, idx.normal_index };
+			for (int i = 0; i < 3; i++) {
+				bool missing = i > 0 && resolved[i] == -1 && !(chunk.relative[c] & (1 << i));
+				if (!missing && (resolved[i] < 0 || resolved[i] >= counts[i])) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// appends copies of the OBJ at source to one file, shifting absolute face indices past the copies
+	// before; only the first copy keeps its mtllib so material ids match between loaders
+	bool replicateObj(const std::string& source, const std::string& target, uint32_t copies, size_t& faces) {
+		std::ifstream in(source);
+		std::ofstream out(target, std::ios::binary);
+		if (!in || !out) {
+			return false;
+		}
+		std::vector<std::string> lines;
+		size_t counts[3] = {};
+		for (std::string line; std::getline(in, line);) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			counts[0] += line.starts_with("v ");
+			counts[1] += line.starts_with("vt ");
+			counts[2] += line.starts_with("vn ");
+			lines.push_back(std::move(line));
+		}
+
+		faces = 0;
+		for (uint32_t copy = 0; copy < copies; copy++) {
+			for (const std::string& line : lines) {
+				if (line.starts_with("mtllib") && copy > 0) {
+					continue;
+				}
+				if (!line.starts_with("f ")) {
+					out << line << '\n';
+					continue;
+				}
+				faces++;
+				out << 'f';
+				std::istringstream corners(line.substr(2));
+				for (std::string corner; corners >> corner;) {
+					out << ' ';
+					// v, v/vt, v//vn or v/vt/vn; relative (negative) indices need no shift
+					size_t start = 0;
+					for (int i = 0; i < 3 && start <= corner.size(); i++) {
+						size_t end = std::min(corner.find('/', start), corner.size());
+						if (end > start) {
+							long index = std::strtol(corner.c_str() + start, nullptr, 10);
+							out << (index > 0 ? index + static_cast<long>(counts[i] * copy) : index);
+						}
+						if (end < corner.size()) {
+							out << '/';
+						}
+						start = end + 1;
+					}
+				}
+				out << '\n';
+			}
+		}
+
+		// lines LoadObj reads with default components or as several files, so the comparison covers them
+		out << "mtllib missing.mtl " << std::filesystem::path(source).stem().string() << ".mtl\n"
+			<< "o defaults\n"
+			<< "v 1 2\n"
+			<< "v x 1.5 0\n"
+			<< "v 0 0 1 0.25 0.5 0.75\n"
+			<< "vt 0.5\n"
+			<< "vn 0 1\n"
+			<< "f -3/-1/-1 -2/-1/-1 -1/-1/-1\n";
+		faces++;
+		return static_cast<bool>(out);
+	}
+
+	bool sameObj(const attrib_t& a, const std::vector<shape_t>& as, const attrib_t& b, const std::vector<shape_t>& bs) {
+		if (a.vertices != b.vertices || a.normals != b.normals || a.texcoords != b.texcoords || a.colors != b.colors
+			|| as.size() != bs.size()) {
+			return false;
+		}
+		for (size_t s = 0; s < as.size(); s++) {
+			const mesh_t& am = as[s].mesh;
+			const mesh_t& bm = bs[s].mesh;
+			bool sameIndices = std::equal(am.indices.begin(), am.indices.end(), bm.indices.begin(), bm.indices.end(),
+				[](const index_t& x, const index_t& y) {
+					return x.vertex_index == y.vertex_index && x.texcoord_index == y.texcoord_index
+						&& x.normal_index == y.normal_index;
+				});
+			if (as[s].name != bs[s].name || !sameIndices || am.num_face_vertices != bm.num_face_vertices
+				|| am.material_ids != bm.material_ids || am.smoothing_group_ids != bm.smoothing_group_ids) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool loadObjParallel(attrib_t* attrib, std::vector<shape_t>* shapes, std::vector<material_t>* materials,
+	std::string* warn, std::string* err, const char* filename, const char* mtlBasedir, threadPool& pool) {
+	attrib->vertices.clear();
+	attrib->normals.clear();
+	attrib->texcoords.clear();
+	attrib->colors.clear();
+	shapes->clear();
+
+	mappedFile file;
+	if (!file.open(filename)) {
+		if (err) {
+			(*err) = "Cannot open file [" + std::string(filename) + "]\n";
+		}
+		return false;
+	}
+
+	const char* data = reinterpret_cast<const char*>(file.data);
+	std::vector<objChunk> chunks = splitChunks(data, file.size, pool.size());
+
+	pool.parallelFor(chunks.size(), [&](size_t i) {
+		parseChunk(chunks[i]);
+	});
+
+	size_t vCount = 0, vtCount = 0, vnCount = 0;
+	for (auto& chunk : chunks) {
+		if (!chunk.error.empty()) {
+			if (err) {
+				(*err) += chunk.error + "\n";
+			}
+			return false;
+		}
+		chunk.vBase = vCount;
+		chunk.vtBase = vtCount;
+		chunk.vnBase = vnCount;
+		vCount += chunk.v.size() / 3;
+		vtCount += chunk.vt.size() / 2;
+		vnCount += chunk.vn.size() / 3;
+	}
+
+	// serial walk over the (few) events: decides shape boundaries and material ids and
+	// gives every segment its final triangle offset
+	std::string baseDir = mtlBasedir ? mtlBasedir : "";
+	if (!baseDir.empty() && baseDir.back() != '/' && baseDir.back() != '\\') {
+		baseDir += '/';
+	}
+	MaterialFileReader materialReader(baseDir);
+	std::vector<material_t> localMaterials;
+	std::vector<material_t>* materialList = materials ? materials : &localMaterials;
+	materialList->clear();
+	std::map<std::string, int> materialMap;
+	std::set<std::string> materialFiles;
+
+	std::vector<std::string> shapeNames;
+	std::vector<uint32_t> shapeTriangles;
+	std::string name;
+	uint32_t triangles = 0;
+	int materialId = -1;
+	unsigned smoothingId = 0;
+
+	for (auto& chunk : chunks) {
+		uint32_t face = 0;
+		uint32_t chunkTriangles = 0;
+		auto closeSegment = [&](uint32_t faceEnd, uint32_t triangleEnd) {
+			if (triangleEnd > chunkTriangles) {
+				chunk.segments.push_back({ face, faceEnd, static_cast<uint32_t>(shapeNames.size()), triangles,
+					materialId, smoothingId });
+				triangles += triangleEnd - chunkTriangles;
+			}
+			face = faceEnd;
+			chunkTriangles = triangleEnd;
+		};
+
+		for (auto& event : chunk.events) {
+			closeSegment(event.face, event.triangles);
+
+			switch (event.type) {
+			case objEventType::object:
+			case objEventType::group:
+				if (triangles > 0) {
+					shapeNames.push_back(name);
+					shapeTriangles.push_back(triangles);
+				}
+				name = event.text;
+				triangles = 0;
+				break;
+			case objEventType::material: {
+				auto it = materialMap.find(event.text);
+				if (it != materialMap.end()) {
+					materialId = it->second;
+				}
+				else {
+					materialId = -1;
+					if (warn) {
+						(*warn) += "material [ '" + event.text + "' ] not found in .mtl\n";
+					}
+				}
+				break;
+			}
+			case objEventType::materialLib: {
+				// like LoadObj: the first file of the line that loads wins, and files loaded before are
+				// skipped without ending the search
+				bool found = false;
+				for (const std::string& file : splitNames(event.text)) {
+					if (materialFiles.count(file)) {
+						found = true;
+						continue;
+					}
+					std::string warnMtl, errMtl;
+					bool loaded = materialReader(file, materialList, &materialMap, &warnMtl, &errMtl);
+					if (warn) {
+						(*warn) += warnMtl;
+					}
+					if (err) {
+						(*err) += errMtl;
+					}
+					if (loaded) {
+						found = true;
+						materialFiles.insert(file);
+						break;
+					}
+				}
+				if (!found && warn) {
+					(*warn) += "Failed to load material file(s). Use default material.\n";
+				}
+				break;
+			}
+			case objEventType::smoothing:
+				smoothingId = event.smoothingId;
+				break;
+			}
+		}
+		closeSegment(static_cast<uint32_t>(chunk.faceSizes.size()), chunk.triangles);
+	}
+	if (triangles > 0) {
+		shapeNames.push_back(name);
+		shapeTriangles.push_back(triangles);
+	}
+
+	shapes->resize(shapeNames.size());
+	for (size_t s = 0; s < shapes->size(); s++) {
+		shape_t& shape = (*shapes)[s];
+		shape.name = shapeNames[s];
+		shape.mesh.indices.resize(size_t(shapeTriangles[s]) * 3);
+		shape.mesh.num_face_vertices.resize(shapeTriangles[s]);
+		shape.mesh.material_ids.resize(shapeTriangles[s]);
+		shape.mesh.smoothing_group_ids.resize(shapeTriangles[s]);
+	}
+
+	attrib->vertices.resize(vCount * 3);
+	attrib->colors.resize(vCount * 3);
+	attrib->texcoords.resize(vtCount * 2);
+	attrib->normals.resize(vnCount * 3);
+
+	pool.parallelFor(chunks.size(), [&](size_t i) {
+		const objChunk& chunk = chunks[i];
+		std::copy(chunk.v.begin(), chunk.v.end(), attrib->vertices.begin() + chunk.vBase * 3);
+		std::copy(chunk.vc.begin(), chunk.vc.end(), attrib->colors.begin() + chunk.vBase * 3);
+		std::copy(chunk.vt.begin(), chunk.vt.end(), attrib->texcoords.begin() + chunk.vtBase * 2);
+		std::copy(chunk.vn.begin(), chunk.vn.end(), attrib->normals.begin() + chunk.vnBase * 3);
+	});
+
+	std::vector<uint8_t> valid(chunks.size());
+	pool.parallelFor(chunks.size(), [&](size_t i) {
+		objChunk& chunk = chunks[i];
+		valid[i] = validateCorners(chunk, *attrib);
+		if (!valid[i]) {
+			return;
+		}
+
+		std::vector<uint32_t> faceCorner(chunk.faceSizes.size());
+		uint32_t first = 0;
+		for (size_t f = 0; f < chunk.faceSizes.size(); f++) {
+			faceCorner[f] = first;
+			first += chunk.faceSizes[f];
+		}
+
+		for (const auto& segment : chunk.segments) {
+			emitSegment(chunk, segment, faceCorner, *attrib, (*shapes)[segment.shape]);
+		}
+	});
+
+	if (std::find(valid.begin(), valid.end(), uint8_t(0)) != valid.end()) {
+		if (err) {
+			(*err) += "Face with invalid vertex index found.\n";
+		}
+		return false;
+	}
+
+	return true;
+}
+
+void benchmarkObjLoading(const char* filename, const char* mtlBasedir, uint32_t copies, threadPool& pool) {
+	std::string target = (std::filesystem::temp_directory_path() / "r2e-bench.obj").string();
+	size_t faces = 0;
+	if (!replicateObj(filename, target, copies, faces)) {
+		LOG_ERROR("cannot write " << target);
+		return;
+	}
+
+	attrib_t serialAttrib, parallelAttrib;
+	std::vector<shape_t> serialShapes, parallelShapes;
+	std::vector<material_t> materials;
+	std::string warn, err;
+
+	auto start = std::chrono::steady_clock::now();
+	bool serialLoaded = LoadObj(&serialAttrib, &serialShapes, &materials, &warn, &err, target.c_str(), mtlBasedir);
+	std::chrono::duration<double, std::milli> serial = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	bool parallelLoaded = loadObjParallel(&parallelAttrib, &parallelShapes, &materials, &warn, &err, target.c_str(),
+		mtlBasedir, pool);
+	std::chrono::duration<double, std::milli> parallel = std::chrono::steady_clock::now() - start;
+
+	std::error_code ec;
+	std::filesystem::remove(target, ec);
+
+	if (!serialLoaded || !parallelLoaded) {
+		LOG_ERROR("obj benchmark failed to load: " << err);
+		return;
+	}
+	bool matches = sameObj(serialAttrib, serialShapes, parallelAttrib, parallelShapes);
+	LOG_INFO("load " << faces << " faces (" << copies << " copies of " << filename << "): LoadObj " << serial.count()
+		<< " ms, loadObjParallel " << parallel.count() << " ms on " << pool.size() << " threads"
+		<< (matches ? "" : " (differs from LoadObj)"));
+}
@@ -0,0 +1,128 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "pacing.h"
+#include <algorithm>
+#include <thread>
+
+using namespace vk;
+
+namespace {
+	const double smoothing = 0.1;
+
+	double toMs(std::chrono::steady_clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	void blend(double& average, double sample) {
+		average += (sample - average) * smoothing;
+	}
+
+	// OS sleeps overshoot by up to a scheduler tick, so the last stretch is spent yielding
+	void preciseSleep(double ms) {
+		using namespace std::chrono;
+		auto until = steady_clock::now() + duration_cast<steady_clock::duration>(duration<double, std::milli>(ms));
+		const double coarseMargin = 2.0;
+		if (ms > coarseMargin) {
+			std::this_thread::sleep_for(duration<double, std::milli>(ms - coarseMargin));
+		}
+		while (steady_clock::now() < until) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+PresentModeKHR choosePresentMode(const std::vector<PresentModeKHR>& available, presentPolicy policy) {
+	std::vector<PresentModeKHR> order;
+	switch (policy) {
+	case presentPolicy::mailbox:
+		// never falls back to a tearing mode: without mailbox the swapchain stays vsynced
+		order = { PresentModeKHR::eMailbox };
+		break;
+	case presentPolicy::immediate:
+		order = { PresentModeKHR::eImmediate, PresentModeKHR::eMailbox };
+		break;
+	case presentPolicy::fifoRelaxed:
+		order = { PresentModeKHR::eFifoRelaxed };
+		break;
+	case presentPolicy::fifo:
+		break;
+	}
+
+	for (auto mode : order) {
+		if (std::find(available.begin(), available.end(), mode) != available.end()) {
+			return mode;
+		}
+	}
+	return PresentModeKHR::eFifo;
+}
+
+void framePacer::sleepUntilInput() {
+	clock::time_point now = clock::now();
+	double wait = enabled ? sleepMs : 0.0;
+
+	if (targetFps > 0.0 && frameStart != clock::time_point()) {
+		double elapsed = toMs(now - frameStart);
+		wait = std::max(wait, 1000.0 / targetFps - elapsed);
+	}
+
+	if (wait > 0.0) {
+		preciseSleep(wait);
+	}
+
+	clock::time_point start = clock::now();
+	if (frameStart != clock::time_point()) {
+		current.frameMs = toMs(start - frameStart);
+	}
+	current.sleepMs = toMs(start - now);
+	frameStart = start;
+}
+
+void framePacer::inputSampled() {
+	inputTime = clock::now();
+	blockedMs = 0.0;
+	current.gpuWaitMs = 0.0;
+	current.acquireMs = 0.0;
+	current.presentMs = 0.0;
+	current.recordMs = 0.0;
+}
+
+void framePacer::record(paceStage stage, clock::duration elapsed) {
+	double ms = toMs(elapsed);
+	switch (stage) {
+	case paceStage::gpuWait:
+		current.gpuWaitMs += ms;
+		blockedMs += ms;
+		break;
+	case paceStage::acquire:
+		current.acquireMs += ms;
+		blockedMs += ms;
+		break;
+	case paceStage::present:
+		current.presentMs += ms;
+		break;
+	case paceStage::record:
+		current.recordMs += ms;
+		break;
+	}
+}
+
+void framePacer::submitted() {
+	current.inputToSubmitMs = toMs(clock::now() - inputTime);
+}
+
+void framePacer::presented() {
+	current.inputToPresentMs = toMs(clock::now() - inputTime);
+
+	// integral controller: grow the pre-input sleep while frames still block after input,
+	// back off as soon as the slack drops under the safety margin
+	sleepMs = std::max(0.0, sleepMs + (blockedMs - safetyMs) * 0.5);
+
+	blend(averages.frameMs, current.frameMs);
+	blend(averages.sleepMs, current.sleepMs);
+	blend(averages.gpuWaitMs, current.gpuWaitMs);
+	blend(averages.acquireMs, current.acquireMs);
+	blend(averages.presentMs, current.presentMs);
+	blend(averages.recordMs, current.recordMs);
+	blend(averages.inputToSubmitMs, current.inputToSubmitMs);
+	blend(averages.inputToPresentMs, current.inputToPresentMs);
+}
@@ -0,0 +1,38 @@
+#version 450
+
+// decodes packedVertex; the renderer draws with shaders/packed.spv in place of shader.vert and uploads
+// quantized vertices for it. it recognises the decoder by the positionDequant block name, so rebuild
+// with debug names kept (glslc packed.vert -o shaders/packed.spv, or run with --hot-reload)
+//
+// packedVertex: position in the submesh's bounds with the bitangent sign in w, octahedral normal
+// and tangent, half-float uv; the fixed-function fetch already turns unorm/snorm/half into floats
+layout (location = 0) in vec4 inPosition;
+layout (location = 1) in vec2 inNormal;
+layout (location = 2) in vec2 inTangent;
+layout (location = 3) in vec2 inTexCoord;
+
+layout (push_constant) uniform positionDequant {
+	vec4 scale;
+	vec4 offset;
+} dequant;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec4 outTangent;
+layout (location = 2) out vec2 outTexCoord;
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+void main(){
+	vec3 position = dequant.offset.xyz + inPosition.xyz * dequant.scale.xyz;
+
+	outNormal = octDecode(inNormal);
+	outTangent = vec4(octDecode(inTangent), inPosition.w * 2.0 - 1.0);
+	outTexCoord = inTexCoord;
+
+	gl_Position = vec4(position.xy, 0.0, 1.0);
+}
@@ -0,0 +1,105 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "pipelinecache.h"
+#include "log.h"
+#include <cstring>
+#include "util.h"
+
+using namespace vk;
+
+void pipelineCacheStore::init(Device dev, PhysicalDevice gpu, const std::string& cachePath) {
+	device = dev;
+	props = gpu.getProperties();
+	path = cachePath;
+
+	mappedFile file;
+	const uint8_t* blob = nullptr;
+	size_t blobSize = 0;
+
+	if (file.open(path) && file.size >= sizeof(pipelineCacheFileHeader)) {
+		pipelineCacheFileHeader header;
+		memcpy(&header, file.data, sizeof(header));
+		const uint8_t* data = file.data + sizeof(header);
+
+		if (header.magic == pipelineCacheMagic && header.version == pipelineCacheVersion
+			&& header.dataSize == file.size - sizeof(header) && header.dataHash == hashBytes(data, header.dataSize)
+			&& validate(data, header.dataSize)) {
+			blob = data;
+			blobSize = header.dataSize;
+		}
+		else {
+			LOG_WARN("pipeline cache " << path << " is stale, starting empty");
+		}
+	}
+
+	PipelineCacheCreateInfo ci{ .initialDataSize = blobSize, .pInitialData = blob };
+	mainCache = device.createPipelineCache(ci);
+
+	LOG_INFO("pipeline cache created (" << blobSize << " bytes loaded)");
+}
+
+void pipelineCacheStore::destroy() {
+	for (auto& worker : workerCaches) {
+		device.destroyPipelineCache(worker);
+	}
+	workerCaches.clear();
+	device.destroyPipelineCache(mainCache);
+	mainCache = nullptr;
+}
+
+bool pipelineCacheStore::validate(const uint8_t* blob, size_t size) const {
+	// VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID
+	const size_t headerOneSize = 16 + VK_UUID_SIZE;
+	if (size < headerOneSize) {
+		return false;
+	}
+
+	uint32_t headerSize, headerVersion, vendorId, deviceId;
+	memcpy(&headerSize, blob, 4);
+	memcpy(&headerVersion, blob + 4, 4);
+	memcpy(&vendorId, blob + 8, 4);
+	memcpy(&deviceId, blob + 12, 4);
+
+	return headerSize >= headerOneSize && headerSize <= size
+		&& headerVersion == static_cast<uint32_t>(PipelineCacheHeaderVersion::eOne)
+		&& vendorId == props.vendorID
+		&& deviceId == props.deviceID
+		&& memcmp(blob + 16, props.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+PipelineCache pipelineCacheStore::createWorkerCache() {
+	PipelineCacheCreateInfo ci{};
+	PipelineCache worker = device.createPipelineCache(ci);
+
+	std::lock_guard<std::mutex> lock(workerMutex);
+	workerCaches.push_back(worker);
+	return worker;
+}
+
+bool pipelineCacheStore::save() {
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		if (!workerCaches.empty()) {
+			device.mergePipelineCaches(mainCache, workerCaches);
+		}
+	}
+
+	std::vector<uint8_t> data = device.getPipelineCacheData(mainCache);
+	if (!validate(data.data(), data.size())) {
+		return false;
+	}
+
+	pipelineCacheFileHeader header{ pipelineCacheMagic, pipelineCacheVersion, data.size(), hashBytes(data.data(), data.size()) };
+
+	std::vector<uint8_t> blob(sizeof(header) + data.size());
+	memcpy(blob.data(), &header, sizeof(header));
+	memcpy(blob.data() + sizeof(header), data.data(), data.size());
+
+	if (!writeFileAtomic(path, blob.data(), blob.size())) {
+		return false;
+	}
+
+	LOG_INFO("pipeline cache written: " << path << " (" << data.size() << " bytes)");
+
+	return true;
+}
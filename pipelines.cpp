@@ -0,0 +1,355 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "pipelines.h"
+#include "log.h"
+#include "cpuprofiler.h"
+#include "util.h"
+
+using namespace vk;
+
+size_t pipelineDescHash::operator()(const pipelineDesc& desc) const {
+	uint64_t h = hashBytes(desc.vertexShader.data(), desc.vertexShader.size());
+	h = hashBytes(desc.fragmentShader.data(), desc.fragmentShader.size(), h);
+	uint32_t state[] = { static_cast<uint32_t>(desc.topology), static_cast<uint32_t>(desc.polygonMode),
+		static_cast<uint32_t>(desc.cullMode), desc.blend };
+	return static_cast<size_t>(hashBytes(state, sizeof(state), h));
+}
+
+void pipelineManager::init(Device dev, pipelineCacheStore& store, shaderRegistry& shaderModules, layoutCache& layoutStore,
+	unsigned threadCount) {
+	device = dev;
+	cacheStore = &store;
+	shaders = &shaderModules;
+	layouts = &layoutStore;
+	compilers = std::make_unique<threadPool>(threadCount);
+
+	LOG_INFO("pipeline manager created (" << compilers->size() << " compile threads)");
+}
+
+void pipelineManager::setTarget(RenderPass rp, uint32_t stride, std::vector<vertexInputMatch> vertexSemantics) {
+	renderPass = rp;
+	vertexStride = stride;
+	semantics = std::move(vertexSemantics);
+}
+
+std::vector<Pipeline> pipelineManager::retarget(uint32_t stride, std::vector<vertexInputMatch> vertexSemantics) {
+	// compiles read the target without the lock, so none may be running while it changes
+	std::vector<std::shared_future<Pipeline>> running;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& item : entries) {
+			running.push_back(item.future);
+			if (item.reloading) {
+				running.push_back(item.replacement);
+			}
+		}
+	}
+	for (auto& job : running) {
+		job.wait();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	vertexStride = stride;
+	semantics = std::move(vertexSemantics);
+
+	std::vector<Pipeline> retired;
+	for (auto& item : entries) {
+		Pipeline old = Pipeline(item.pipeline.exchange(VK_NULL_HANDLE, std::memory_order_acq_rel));
+		if (old) {
+			retired.push_back(old);
+		}
+		// a reload compiled against the old layout
+		if (item.reloading) {
+			Pipeline replacement = item.replacement.get();
+			if (replacement) {
+				retired.push_back(replacement);
+			}
+			item.reloading = false;
+			item.reloadAgain = false;
+		}
+		item.future = submitCompile(item, item.layout, true);
+	}
+	return retired;
+}
+
+void pipelineManager::destroy() {
+	// joins the workers, so every compile has finished afterwards
+	compilers.reset();
+
+	for (auto& item : entries) {
+		item.future.wait();
+		Pipeline pipeline = Pipeline(item.pipeline.load());
+		if (pipeline) {
+			device.destroyPipeline(pipeline);
+		}
+		// a reload that never reached a frame boundary
+		if (item.reloading) {
+			Pipeline replacement = item.replacement.get();
+			if (replacement) {
+				device.destroyPipeline(replacement);
+			}
+		}
+	}
+	entries.clear();
+	lookup.clear();
+	// worker caches belong to the store, which merges and destroys them
+	freeCaches.clear();
+}
+
+pipelineHandle pipelineManager::request(const pipelineDesc& desc) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = lookup.find(desc);
+	if (found != lookup.end()) {
+		return found->second;
+	}
+
+	pipelineHandle handle = static_cast<pipelineHandle>(entries.size());
+	entry& item = entries.emplace_back();
+	item.desc = desc;
+	lookup.emplace(desc, handle);
+
+	item.future = submitCompile(item, item.layout, true);
+
+	return handle;
+}
+
+std::shared_future<Pipeline> pipelineManager::submitCompile(entry& item, PipelineLayout& layoutOut, bool publish) {
+	// deque entries never move, so the job can hold on to item
+	return compilers->submit([this, &item, &layoutOut, publish]() {
+		CPU_ZONE("compile pipeline");
+		PipelineCache cache = borrowCache();
+		Pipeline pipeline;
+		try {
+			pipeline = compile(item.desc, cache, layoutOut);
+		}
+		catch (const std::exception& e) {
+			LOG_ERROR("pipeline compile failed: " << e.what());
+		}
+		returnCache(cache);
+		if (publish) {
+			item.pipeline.store(static_cast<VkPipeline>(pipeline), std::memory_order_release);
+		}
+		return pipeline;
+	}).share();
+}
+
+size_t pipelineManager::reload(const std::string& shaderPath) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t count = 0;
+	for (auto& item : entries) {
+		if (item.desc.vertexShader != shaderPath && item.desc.fragmentShader != shaderPath) {
+			continue;
+		}
+		count++;
+		if (item.reloading) {
+			// the running compile may have read the old file; go again once it lands
+			item.reloadAgain = true;
+			continue;
+		}
+		item.reloading = true;
+		item.replacement = submitCompile(item, item.replacementLayout, false);
+	}
+	return count;
+}
+
+std::vector<Pipeline> pipelineManager::swapReloaded() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<Pipeline> retired;
+	for (auto& item : entries) {
+		if (!item.reloading || item.replacement.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			continue;
+		}
+		item.reloading = false;
+
+		// a failed compile (e.g. a shader with errors) keeps the pipeline that worked
+		Pipeline replacement = item.replacement.get();
+		if (replacement) {
+			Pipeline old = Pipeline(item.pipeline.load(std::memory_order_acquire));
+			if (old) {
+				retired.push_back(old);
+			}
+			item.layout = item.replacementLayout;
+			item.pipeline.store(static_cast<VkPipeline>(replacement), std::memory_order_release);
+			LOG_INFO("pipeline reloaded: " << item.desc.vertexShader << " + " << item.desc.fragmentShader);
+		}
+
+		if (item.reloadAgain) {
+			item.reloadAgain = false;
+			item.reloading = true;
+			item.replacement = submitCompile(item, item.replacementLayout, false);
+		}
+	}
+	return retired;
+}
+
+bool pipelineManager::ready(pipelineHandle handle) const {
+	return resolve(handle, nullptr) != Pipeline();
+}
+
+Pipeline pipelineManager::resolve(pipelineHandle handle, Pipeline fallback) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (handle >= entries.size()) {
+		return fallback;
+	}
+	VkPipeline pipeline = entries[handle].pipeline.load(std::memory_order_acquire);
+	return pipeline != VK_NULL_HANDLE ? Pipeline(pipeline) : fallback;
+}
+
+void pipelineManager::resolveDraws(std::vector<drawItem>& draws, Pipeline fallback, PipelineLayout fallbackLayout) const {
+	// one lock for the whole list; handles stay on the draws so reloaded pipelines are picked up
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& item : draws) {
+		if (item.pipelineId >= entries.size()) {
+			continue;
+		}
+		const entry& e = entries[item.pipelineId];
+		// the layout is written before the pipeline is published
+		VkPipeline pipeline = e.pipeline.load(std::memory_order_acquire);
+		item.pipeline = pipeline != VK_NULL_HANDLE ? Pipeline(pipeline) : fallback;
+		item.layout = pipeline != VK_NULL_HANDLE ? e.layout : fallbackLayout;
+	}
+}
+
+PipelineLayout pipelineManager::layout(pipelineHandle handle) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (handle >= entries.size() || !entries[handle].pipeline.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	return entries[handle].layout;
+}
+
+Pipeline pipelineManager::wait(pipelineHandle handle) {
+	std::shared_future<Pipeline> future;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		future = entries[handle].future;
+	}
+	return future.get();
+}
+
+PipelineCache pipelineManager::borrowCache() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!freeCaches.empty()) {
+			PipelineCache cache = freeCaches.back();
+			freeCaches.pop_back();
+			return cache;
+		}
+	}
+	return cacheStore->createWorkerCache();
+}
+
+void pipelineManager::returnCache(PipelineCache cache) {
+	std::lock_guard<std::mutex> lock(mutex);
+	freeCaches.push_back(cache);
+}
+
+Pipeline pipelineManager::compile(const pipelineDesc& desc, PipelineCache cache, PipelineLayout& layout) {
+	// the registry owns the modules
+	shaderReflection vertReflection, fragReflection;
+	ShaderModule vertModule = shaders->load(desc.vertexShader, &vertReflection);
+	ShaderModule fragModule = shaders->load(desc.fragmentShader, &fragReflection);
+	if (!vertModule || !fragModule) {
+		return nullptr;
+	}
+
+	VertexInputBindingDescription binding;
+	std::vector<VertexInputAttributeDescription> attributes;
+	if (!buildVertexInput(vertReflection, vertexStride, semantics, binding, attributes)) {
+		return nullptr;
+	}
+
+	layout = layouts->pipelineLayout({ &vertReflection, &fragReflection });
+
+	PipelineShaderStageCreateInfo vCi{ .stage = ShaderStageFlagBits::eVertex,
+	.module = vertModule,
+	.pName = "main" };
+
+	PipelineShaderStageCreateInfo fCi{ .stage = ShaderStageFlagBits::eFragment,
+	.module = fragModule,
+	.pName = "main" };
+
+	PipelineShaderStageCreateInfo shaderStages[] = { vCi, fCi };
+
+	// a shader without vertex inputs (e.g. generating vertices itself) binds nothing
+	PipelineVertexInputStateCreateInfo vi{ .vertexBindingDescriptionCount = attributes.empty() ? 0u : 1u,
+	.pVertexBindingDescriptions = &binding,
+	.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size()),
+	.pVertexAttributeDescriptions = attributes.data() };
+
+	PipelineInputAssemblyStateCreateInfo ia{ .topology = desc.topology };
+
+	// viewport and scissor are set per frame so a resized swapchain keeps the same pipeline
+	PipelineViewportStateCreateInfo viewport{
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+
+	DynamicState dynamicStates[] = { DynamicState::eViewport, DynamicState::eScissor };
+
+	PipelineDynamicStateCreateInfo dynamicState{
+		.dynamicStateCount = 2,
+		.pDynamicStates = dynamicStates
+	};
+
+	PipelineRasterizationStateCreateInfo rs{
+		.polygonMode = desc.polygonMode,
+		.cullMode = desc.cullMode,
+		.frontFace = FrontFace::eClockwise,
+		.lineWidth = 1.0f
+	};
+
+	ColorComponentFlags flags = ColorComponentFlagBits::eR | ColorComponentFlagBits::eG | ColorComponentFlagBits::eB
+		| ColorComponentFlagBits::eA;
+
+	PipelineColorBlendAttachmentState colorBlendAttachment{
+		.blendEnable = desc.blend,
+		.srcColorBlendFactor = desc.blend ? BlendFactor::eSrcAlpha : BlendFactor::eZero,
+		.dstColorBlendFactor = desc.blend ? BlendFactor::eOneMinusSrcAlpha : BlendFactor::eOne,
+		.colorBlendOp = BlendOp::eAdd,
+		.srcAlphaBlendFactor = desc.blend ? BlendFactor::eOne : BlendFactor::eZero,
+		.dstAlphaBlendFactor = BlendFactor::eZero,
+		.alphaBlendOp = BlendOp::eAdd,
+		.colorWriteMask = flags
+	};
+
+	PipelineColorBlendStateCreateInfo cbs{
+		.logicOp = LogicOp::eClear,
+		.attachmentCount = 1,
+		.pAttachments = &colorBlendAttachment
+
+	};
+
+	GraphicsPipelineCreateInfo pipelineCi{
+		.stageCount = 2,
+		.pStages = shaderStages,
+		.pVertexInputState = &vi,
+		.pInputAssemblyState = &ia,
+		.pViewportState = &viewport,
+		.pRasterizationState = &rs,
+		.pColorBlendState = &cbs,
+		.pDynamicState = &dynamicState,
+		.layout = layout,
+		.renderPass = renderPass
+	};
+
+	Result result;
+	Pipeline pipeline;
+
+	std::tie(result, pipeline) = device.createGraphicsPipeline(cache, pipelineCi);
+	if (result != Result::eSuccess) {
+		LOG_ERROR("pipeline compile failed: " << desc.vertexShader << " + " << desc.fragmentShader
+			<< " (" << to_string(result) << ")");
+		if (pipeline) {
+			device.destroyPipeline(pipeline);
+		}
+		return nullptr;
+	}
+
+	LOG_INFO("pipeline compiled: " << desc.vertexShader << " + " << desc.fragmentShader);
+
+	return pipeline;
+}
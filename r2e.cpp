@@ -3,8 +3,16 @@
 
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
+#include <cstdlib>
+#include <string>
 #include <vector>
 #include "renderer.h"
+#include "allocator.h"
+#include "reflect.h"
+#include "meshlet.h"
+#include "objparser.h"
+#include "log.h"
+#include "util.h"
 
 
 
@@ -29,16 +37,156 @@ void init() {
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+	// --bench-record [draws]: time command recording at 1/2/4/8 threads instead of running
+	// --bench-cull [objects]: time frustum culling on every SIMD path, without starting the renderer
+	// --bench-obj [copies]: time tinyobj::LoadObj against loadObjParallel on p1.obj repeated copies times
+	// --self-test: run the CPU-side checks (allocator, shader reflection, meshlet culling) and exit non-zero if any fails
+	// --headless [frames]: render offscreen without a window, then exit
+	// --capture file.ppm: with --headless, read the last frame back and write it out
+	// --gpu-trace file.json: on exit, write the last frames' GPU regions as a Chrome trace
+	// --cpu-trace file.json: on exit, write the last frames' CPU zones as a Chrome trace
+	// --log-level trace|debug|info|warn|error|off: hide messages below the level (default info)
+	// --log-json: one JSON object per log line instead of text
+	// --no-meshlet-cull: draw every submesh whole instead of culling its meshlets each frame
+	// --cpu-meshlet-cull: cull meshlets on the CPU instead of in the compute pass
+	// --hot-reload: recompile shaders with glslc when their GLSL source changes
+	// --lod-error pixels: draw the coarsest LOD within this screen-space error (default 1, 0 for full detail)
+	bool benchRecord = false;
+	uint32_t benchDraws = 20000;
+	bool benchCull = false;
+	uint32_t benchObjects = 100000;
+	bool benchObj = false;
+	uint32_t benchObjCopies = 100;
+	bool selfTest = false;
+	uint32_t headlessFrames = 0;
+	std::string capturePath;
+	std::string gpuTracePath;
+	std::string cpuTracePath;
+	logger::format logFormat = logger::format::text;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+		if (arg == "--bench-record") {
+			benchRecord = true;
+			if (hasValue) {
+				benchDraws = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--bench-cull") {
+			benchCull = true;
+			if (hasValue) {
+				benchObjects = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--bench-obj") {
+			benchObj = true;
+			if (hasValue) {
+				benchObjCopies = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--self-test") {
+			selfTest = true;
+		}
+		else if (arg == "--headless") {
+			r.headless = true;
+			headlessFrames = 100;
+			if (hasValue) {
+				headlessFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+		else if (arg == "--capture" && hasValue) {
+			capturePath = argv[++i];
+			r.captureFrames = true;
+		}
+		else if (arg == "--gpu-trace" && hasValue) {
+			gpuTracePath = argv[++i];
+		}
+		else if (arg == "--cpu-trace" && hasValue) {
+			cpuTracePath = argv[++i];
+		}
+		else if (arg == "--log-level" && hasValue) {
+			logLevel level;
+			if (parseLogLevel(argv[++i], level)) {
+				engineLog.setLevel(level);
+			}
+			else {
+				LOG_WARN("unknown log level " << argv[i]);
+			}
+		}
+		else if (arg == "--log-json") {
+			logFormat = logger::format::json;
+		}
+		else if (arg == "--no-meshlet-cull") {
+			r.meshletCulling = false;
+		}
+		else if (arg == "--cpu-meshlet-cull") {
+			r.gpuMeshletCulling = false;
+		}
+		else if (arg == "--hot-reload") {
+			r.hotReload = true;
+		}
+		else if (arg == "--lod-error" && hasValue) {
+			r.lodPixelError = std::strtof(argv[++i], nullptr);
+		}
+	}
+
+	engineLog.init(logFormat);
+	if (selfTest) {
+		bool passed = allocatorSelfTest();
+		passed = reflectionSelfTest() && passed;
+		passed = meshletSelfTest(r.viewProj, r.viewForward) && passed;
+		engineLog.shutdown();
+		return passed ? 0 : 1;
+	}
+	if (benchCull) {
+		benchmarkCulling(benchObjects, 100);
+		engineLog.shutdown();
+		return 0;
+	}
+	if (benchObj) {
+		benchmarkObjLoading("models/p1.obj", "models/", benchObjCopies, r.workers);
+		engineLog.shutdown();
+		return 0;
+	}
+	cpuProfile.setThreadName("main");
 	r.windowInit();
 	r.init();
-	r.update();
+	int status = 0;
+	if (benchRecord) {
+		r.benchmarkRecording(benchDraws, 100);
+	}
+	else if (r.headless) {
+		r.runHeadless(headlessFrames);
+
+		std::vector<uint8_t> pixels;
+		if (!capturePath.empty()) {
+			if (r.readback(pixels) && writePpm(capturePath, r.extent.width, r.extent.height, pixels.data())) {
+				LOG_INFO("captured " << capturePath);
+			}
+			else {
+				LOG_ERROR("capture failed");
+				status = 1;
+			}
+		}
+	}
+	else {
+		r.update();
+	}
+	if (!gpuTracePath.empty()) {
+		r.device->waitIdle();
+		if (!r.gpuProfile.writeChromeTrace(gpuTracePath)) {
+			LOG_ERROR("gpu trace failed");
+			status = 1;
+		}
+	}
+	if (!cpuTracePath.empty() && !cpuProfile.writeChromeTrace(cpuTracePath)) {
+		LOG_ERROR("cpu trace failed");
+		status = 1;
+	}
 	r.cleanup();
+	engineLog.shutdown();
 
-
-
-	return 0;
+	return status;
 }
-
-
@@ -0,0 +1,696 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "reflect.h"
+#include "log.h"
+#include "util.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace vk;
+
+namespace {
+	enum op : uint32_t {
+		opName = 5,
+		opMemberName = 6,
+		opEntryPoint = 15,
+		opTypeBool = 20,
+		opTypeInt = 21,
+		opTypeFloat = 22,
+		opTypeVector = 23,
+		opTypeMatrix = 24,
+		opTypeImage = 25,
+		opTypeSampler = 26,
+		opTypeSampledImage = 27,
+		opTypeArray = 28,
+		opTypeRuntimeArray = 29,
+		opTypeStruct = 30,
+		opTypePointer = 32,
+		opConstant = 43,
+		opSpecConstantTrue = 48,
+		opSpecConstantFalse = 49,
+		opSpecConstant = 50,
+		opVariable = 59,
+		opDecorate = 71,
+		opMemberDecorate = 72,
+		opTypeAccelerationStructure = 5341
+	};
+
+	enum decoration : uint32_t {
+		decSpecId = 1,
+		decBlock = 2,
+		decBufferBlock = 3,
+		decArrayStride = 6,
+		decMatrixStride = 7,
+		decBuiltIn = 11,
+		decLocation = 30,
+		decBinding = 33,
+		decDescriptorSet = 34,
+		decOffset = 35
+	};
+
+	enum storageClass : uint32_t {
+		storageUniformConstant = 0,
+		storageInput = 1,
+		storageUniform = 2,
+		storagePushConstant = 9,
+		storageStorageBuffer = 12
+	};
+
+	const uint32_t unset = UINT32_MAX;
+
+	struct spirvId {
+		uint32_t opcode = 0;
+		std::vector<uint32_t> operands;		// words after the result id
+		std::string name;
+		uint32_t location = unset;
+		uint32_t binding = unset;
+		uint32_t set = unset;
+		uint32_t specId = unset;
+		uint32_t arrayStride = 0;
+		bool builtIn = false;
+		bool block = false;
+		bool bufferBlock = false;
+		std::vector<uint32_t> memberOffsets;
+		std::vector<uint32_t> memberMatrixStrides;
+	};
+
+	std::string literalString(const uint32_t* words, size_t count) {
+		const char* chars = reinterpret_cast<const char*>(words);
+		return std::string(chars, strnlen(chars, count * sizeof(uint32_t)));
+	}
+
+	ShaderStageFlagBits stageOf(uint32_t executionModel) {
+		switch (executionModel) {
+		case 0: return ShaderStageFlagBits::eVertex;
+		case 1: return ShaderStageFlagBits::eTessellationControl;
+		case 2: return ShaderStageFlagBits::eTessellationEvaluation;
+		case 3: return ShaderStageFlagBits::eGeometry;
+		case 4: return ShaderStageFlagBits::eFragment;
+		default: return ShaderStageFlagBits::eCompute;
+		}
+	}
+
+	struct reflector {
+		std::vector<spirvId> ids;
+
+		const spirvId* get(uint32_t id) const {
+			return id < ids.size() && ids[id].opcode ? &ids[id] : nullptr;
+		}
+
+		// byte size under the module's explicit layout decorations
+		uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) const {
+			const spirvId* type = get(typeId);
+			if (!type) {
+				return 0;
+			}
+			switch (type->opcode) {
+			case opTypeBool:
+				return 4;
+			case opTypeInt:
+			case opTypeFloat:
+				return type->operands[0] / 8;
+			case opTypeVector:
+				return sizeOf(type->operands[0]) * type->operands[1];
+			case opTypeMatrix:
+				return (matrixStride ? matrixStride : sizeOf(type->operands[0])) * type->operands[1];
+			case opTypeArray: {
+				const spirvId* length = get(type->operands[1]);
+				uint32_t count = length && length->opcode == opConstant ? length->operands[1] : 1;
+				uint32_t stride = type->arrayStride ? type->arrayStride : sizeOf(type->operands[0]);
+				return stride * count;
+			}
+			case opTypeStruct: {
+				uint32_t size = 0;
+				for (size_t i = 0; i < type->operands.size(); i++) {
+					uint32_t offset = i < type->memberOffsets.size() ? type->memberOffsets[i] : 0;
+					uint32_t stride = i < type->memberMatrixStrides.size() ? type->memberMatrixStrides[i] : 0;
+					size = std::max(size, offset + sizeOf(type->operands[i], stride));
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+
+		bool inputFormat(uint32_t typeId, Format& format, uint32_t& locations) const {
+			const spirvId* type = get(typeId);
+			if (!type) {
+				return false;
+			}
+			locations = 1;
+			if (type->opcode == opTypeMatrix) {
+				// a matrix input takes one location per column
+				locations = type->operands[1];
+				type = get(type->operands[0]);
+			}
+
+			uint32_t components = 1;
+			if (type && type->opcode == opTypeVector) {
+				components = type->operands[1];
+				type = get(type->operands[0]);
+			}
+			if (!type || components < 1 || components > 4) {
+				return false;
+			}
+
+			static const Format float32[] = { Format::eR32Sfloat, Format::eR32G32Sfloat, Format::eR32G32B32Sfloat, Format::eR32G32B32A32Sfloat };
+			static const Format float16[] = { Format::eR16Sfloat, Format::eR16G16Sfloat, Format::eR16G16B16Sfloat, Format::eR16G16B16A16Sfloat };
+			static const Format sint32[] = { Format::eR32Sint, Format::eR32G32Sint, Format::eR32G32B32Sint, Format::eR32G32B32A32Sint };
+			static const Format uint32[] = { Format::eR32Uint, Format::eR32G32Uint, Format::eR32G32B32Uint, Format::eR32G32B32A32Uint };
+
+			uint32_t width = type->operands[0];
+			if (type->opcode == opTypeFloat && width == 32) {
+				format = float32[components - 1];
+			}
+			else if (type->opcode == opTypeFloat && width == 16) {
+				format = float16[components - 1];
+			}
+			else if (type->opcode == opTypeInt && width == 32) {
+				format = type->operands[1] ? sint32[components - 1] : uint32[components - 1];
+			}
+			else {
+				return false;
+			}
+			return true;
+		}
+
+		bool descriptorType(uint32_t typeId, uint32_t storage, DescriptorType& type, uint32_t& count) const {
+			const spirvId* t = get(typeId);
+			count = 1;
+			// arrays of descriptors: arrays of arrays multiply out
+			while (t && (t->opcode == opTypeArray || t->opcode == opTypeRuntimeArray)) {
+				if (t->opcode == opTypeRuntimeArray) {
+					count = 0;
+				}
+				else {
+					const spirvId* length = get(t->operands[1]);
+					count *= length && length->opcode == opConstant ? length->operands[1] : 1;
+				}
+				t = get(t->operands[0]);
+			}
+			if (!t) {
+				return false;
+			}
+
+			switch (t->opcode) {
+			case opTypeStruct:
+				if (storage == storageStorageBuffer || t->bufferBlock) {
+					type = DescriptorType::eStorageBuffer;
+				}
+				else {
+					type = DescriptorType::eUniformBuffer;
+				}
+				return true;
+			case opTypeSampler:
+				type = DescriptorType::eSampler;
+				return true;
+			case opTypeSampledImage:
+				type = DescriptorType::eCombinedImageSampler;
+				return true;
+			case opTypeAccelerationStructure:
+				type = DescriptorType::eAccelerationStructureKHR;
+				return true;
+			case opTypeImage: {
+				// operands: sampled type, dim, depth, arrayed, ms, sampled, format
+				uint32_t dim = t->operands[1];
+				uint32_t sampled = t->operands[5];
+				if (dim == 6) {
+					type = DescriptorType::eInputAttachment;
+				}
+				else if (dim == 5) {
+					type = sampled == 2 ? DescriptorType::eStorageTexelBuffer : DescriptorType::eUniformTexelBuffer;
+				}
+				else {
+					type = sampled == 2 ? DescriptorType::eStorageImage : DescriptorType::eSampledImage;
+				}
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+	};
+}
+
+bool reflectSpirv(const uint32_t* code, size_t wordCount, shaderReflection& out) {
+	if (wordCount < 5 || code[0] != 0x07230203) {
+		return false;
+	}
+
+	reflector r;
+	r.ids.resize(code[3]);
+	out = {};
+
+	bool hasEntry = false;
+	std::vector<uint32_t> variables;
+	std::vector<uint32_t> specConstants;
+
+	for (size_t pos = 5; pos < wordCount;) {
+		uint32_t opcode = code[pos] & 0xffff;
+		uint32_t count = code[pos] >> 16;
+		if (count == 0 || pos + count > wordCount) {
+			return false;
+		}
+		const uint32_t* words = code + pos + 1;
+		uint32_t operandCount = count - 1;
+		pos += count;
+
+		switch (opcode) {
+		case opName:
+			if (operandCount >= 1 && words[0] < r.ids.size()) {
+				r.ids[words[0]].name = literalString(words + 1, operandCount - 1);
+			}
+			break;
+		case opEntryPoint:
+			// the first entry point decides the stage; modules here carry one each
+			if (!hasEntry && operandCount >= 1) {
+				out.stage = stageOf(words[0]);
+				hasEntry = true;
+			}
+			break;
+		case opDecorate: {
+			if (operandCount < 2 || words[0] >= r.ids.size()) {
+				break;
+			}
+			spirvId& target = r.ids[words[0]];
+			uint32_t value = operandCount >= 3 ? words[2] : 0;
+			switch (words[1]) {
+			case decSpecId: target.specId = value; break;
+			case decBlock: target.block = true; break;
+			case decBufferBlock: target.bufferBlock = true; break;
+			case decArrayStride: target.arrayStride = value; break;
+			case decBuiltIn: target.builtIn = true; break;
+			case decLocation: target.location = value; break;
+			case decBinding: target.binding = value; break;
+			case decDescriptorSet: target.set = value; break;
+			}
+			break;
+		}
+		case opMemberDecorate: {
+			if (operandCount < 4 || words[0] >= r.ids.size()) {
+				break;
+			}
+			spirvId& target = r.ids[words[0]];
+			uint32_t member = words[1];
+			if (words[2] == decOffset) {
+				target.memberOffsets.resize(std::max<size_t>(target.memberOffsets.size(), member + 1));
+				target.memberOffsets[member] = words[3];
+			}
+			else if (words[2] == decMatrixStride) {
+				target.memberMatrixStrides.resize(std::max<size_t>(target.memberMatrixStrides.size(), member + 1));
+				target.memberMatrixStrides[member] = words[3];
+			}
+			else if (words[2] == decBuiltIn) {
+				target.builtIn = true;
+			}
+			break;
+		}
+		case opTypeBool:
+		case opTypeInt:
+		case opTypeFloat:
+		case opTypeVector:
+		case opTypeMatrix:
+		case opTypeImage:
+		case opTypeSampler:
+		case opTypeSampledImage:
+		case opTypeArray:
+		case opTypeRuntimeArray:
+		case opTypeStruct:
+		case opTypePointer:
+		case opTypeAccelerationStructure:
+			if (operandCount >= 1 && words[0] < r.ids.size()) {
+				spirvId& id = r.ids[words[0]];
+				id.opcode = opcode;
+				id.operands.assign(words + 1, words + operandCount);
+			}
+			break;
+		case opConstant:
+		case opSpecConstantTrue:
+		case opSpecConstantFalse:
+		case opSpecConstant:
+		case opVariable:
+			// result type, result id, then the rest; operands keep the result type first
+			if (operandCount >= 2 && words[1] < r.ids.size()) {
+				spirvId& id = r.ids[words[1]];
+				id.opcode = opcode;
+				id.operands.assign(words, words + operandCount);
+				id.operands.erase(id.operands.begin() + 1);
+				if (opcode == opVariable) {
+					variables.push_back(words[1]);
+				}
+				else if (opcode != opConstant) {
+					specConstants.push_back(words[1]);
+				}
+			}
+			break;
+		}
+	}
+
+	if (!hasEntry) {
+		return false;
+	}
+
+	for (uint32_t varId : variables) {
+		const spirvId& var = r.ids[varId];
+		const spirvId* pointer = r.get(var.operands[0]);
+		if (!pointer || pointer->opcode != opTypePointer || var.operands.size() < 2) {
+			continue;
+		}
+		uint32_t storage = var.operands[1];
+		uint32_t typeId = pointer->operands[1];
+
+		if (storage == storageInput && out.stage == ShaderStageFlagBits::eVertex) {
+			if (var.builtIn || var.location == unset) {
+				continue;
+			}
+			Format format;
+			uint32_t locations;
+			if (!r.inputFormat(typeId, format, locations)) {
+				LOG_WARN("reflection: unsupported vertex input " << var.name);
+				return false;
+			}
+			for (uint32_t i = 0; i < locations; i++) {
+				out.inputs.push_back({ var.location + i, format, var.name });
+			}
+		}
+		else if (storage == storageUniformConstant || storage == storageUniform || storage == storageStorageBuffer) {
+			if (var.binding == unset) {
+				continue;
+			}
+			reflectedBinding binding{ .set = var.set == unset ? 0 : var.set,
+			.binding = var.binding,
+			.stages = out.stage,
+			.name = var.name };
+			if (!r.descriptorType(typeId, storage, binding.type, binding.count)) {
+				LOG_WARN("reflection: unsupported descriptor " << var.name);
+				return false;
+			}
+			out.bindings.push_back(binding);
+		}
+		else if (storage == storagePushConstant) {
+			const spirvId* block = r.get(typeId);
+			uint32_t size = r.sizeOf(typeId);
+			uint32_t offset = 0;
+			if (block && !block->memberOffsets.empty()) {
+				offset = *std::min_element(block->memberOffsets.begin(), block->memberOffsets.end());
+			}
+			if (size > offset) {
+				out.pushConstants.push_back({ .stageFlags = out.stage, .offset = offset, .size = size - offset });
+			}
+			if (block) {
+				out.pushConstantBlock = block->name;
+			}
+		}
+	}
+
+	for (uint32_t constId : specConstants) {
+		const spirvId& constant = r.ids[constId];
+		if (constant.specId != unset) {
+			out.specConstants.push_back({ constant.specId, r.sizeOf(constant.operands[0]), constant.name });
+		}
+	}
+
+	std::sort(out.inputs.begin(), out.inputs.end(), [](const reflectedInput& a, const reflectedInput& b) {
+		return a.location < b.location;
+	});
+	std::sort(out.bindings.begin(), out.bindings.end(), [](const reflectedBinding& a, const reflectedBinding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(out.specConstants.begin(), out.specConstants.end(), [](const reflectedSpecConstant& a, const reflectedSpecConstant& b) {
+		return a.id < b.id;
+	});
+
+	return true;
+}
+
+bool buildVertexInput(const shaderReflection& vertexStage, uint32_t stride, const std::vector<vertexInputMatch>& semantics,
+	VertexInputBindingDescription& binding, std::vector<VertexInputAttributeDescription>& attributes) {
+	binding = { .binding = 0, .stride = stride, .inputRate = VertexInputRate::eVertex };
+	attributes.clear();
+
+	bool overrides = std::any_of(semantics.begin(), semantics.end(), [](const vertexInputMatch& semantic) {
+		return semantic.name != nullptr;
+	});
+
+	for (const auto& input : vertexStage.inputs) {
+		// an override cannot tell a stripped input apart from any other, so guessing by location could
+		// bind the wrong member
+		if (overrides && input.name.empty()) {
+			LOG_ERROR("vertex input at location " << input.location
+				<< " has no debug name, but the vertex layout matches some inputs by name");
+			return false;
+		}
+
+		auto match = std::find_if(semantics.begin(), semantics.end(), [&](const vertexInputMatch& semantic) {
+			return semantic.name && input.name == semantic.name;
+		});
+		if (match == semantics.end()) {
+			match = std::find_if(semantics.begin(), semantics.end(), [&](const vertexInputMatch& semantic) {
+				return !semantic.name && semantic.location == input.location;
+			});
+		}
+		if (match == semantics.end()) {
+			LOG_ERROR("vertex input " << (input.name.empty() ? "(unnamed)" : input.name) << " at location "
+				<< input.location << " matches no vertex attribute");
+			return false;
+		}
+
+		attributes.push_back({ .location = input.location,
+		.binding = 0,
+		.format = match->format != Format::eUndefined ? match->format : input.format,
+		.offset = match->offset });
+	}
+	return true;
+}
+
+namespace {
+	bool loadWords(const char* path, std::vector<uint32_t>& words) {
+		mappedFile file;
+		if (!file.open(path) || file.size % sizeof(uint32_t) != 0) {
+			return false;
+		}
+		words.resize(file.size / sizeof(uint32_t));
+		memcpy(words.data(), file.data, file.size);
+		return true;
+	}
+
+	// what spirv-opt --strip-debug and glslc -g0 leave of the names
+	std::vector<uint32_t> stripNames(const std::vector<uint32_t>& words) {
+		std::vector<uint32_t> out(words.begin(), words.begin() + std::min<size_t>(5, words.size()));
+		for (size_t pos = 5; pos < words.size();) {
+			uint32_t count = std::max(words[pos] >> 16, 1u);
+			uint32_t opcode = words[pos] & 0xffff;
+			if (opcode != opName && opcode != opMemberName) {
+				out.insert(out.end(), words.begin() + pos, words.begin() + std::min(pos + count, words.size()));
+			}
+			pos += count;
+		}
+		return out;
+	}
+}
+
+bool reflectionSelfTest() {
+	bool passed = true;
+	auto check = [&](bool condition, const char* what) {
+		if (!condition) {
+			LOG_ERROR("reflection self-test failed: " << what);
+			passed = false;
+		}
+	};
+
+	std::vector<uint32_t> vert, frag, packed, cull;
+	if (!loadWords("shaders/vert.spv", vert) || !loadWords("shaders/frag.spv", frag)
+		|| !loadWords("shaders/packed.spv", packed) || !loadWords("shaders/cull.spv", cull)) {
+		LOG_ERROR("reflection self-test failed: shaders/vert.spv, frag.spv, packed.spv and cull.spv must be readable");
+		return false;
+	}
+
+	shaderReflection vs, fs;
+	check(reflectSpirv(vert.data(), vert.size(), vs), "vert.spv reflects");
+	check(vs.stage == ShaderStageFlagBits::eVertex, "vert.spv is a vertex shader");
+	check(vs.inputs.size() == 1 && vs.inputs[0].location == 0 && vs.inputs[0].format == Format::eR32G32Sfloat
+		&& vs.inputs[0].name == "positions", "vert.spv takes a vec2 named positions at location 0");
+	check(vs.bindings.empty() && vs.pushConstants.empty() && vs.pushConstantBlock.empty(), "vert.spv has no resources");
+	check(reflectSpirv(frag.data(), frag.size(), fs), "frag.spv reflects");
+	check(fs.stage == ShaderStageFlagBits::eFragment && fs.inputs.empty(), "frag.spv is a fragment shader");
+
+	// packedVertex's position, normal, tangent and uv, and the per-submesh positionDequant
+	shaderReflection ps;
+	check(reflectSpirv(packed.data(), packed.size(), ps), "packed.spv reflects");
+	check(ps.stage == ShaderStageFlagBits::eVertex && ps.inputs.size() == 4
+		&& ps.inputs[0].location == 0 && ps.inputs[0].format == Format::eR32G32B32A32Sfloat
+		&& ps.inputs[1].location == 1 && ps.inputs[1].format == Format::eR32G32Sfloat
+		&& ps.inputs[2].location == 2 && ps.inputs[2].format == Format::eR32G32Sfloat
+		&& ps.inputs[3].location == 3 && ps.inputs[3].format == Format::eR32G32Sfloat, "packed.spv takes packedVertex's inputs");
+	check(ps.pushConstants.size() == 1 && ps.pushConstants[0].offset == 0 && ps.pushConstants[0].size == 32
+		&& ps.pushConstantBlock == "positionDequant", "packed.spv pushes positionDequant");
+
+	// the meshlet table, submesh states and commands of the meshlet cull pass, and its cullView
+	shaderReflection cs;
+	check(reflectSpirv(cull.data(), cull.size(), cs), "cull.spv reflects");
+	check(cs.stage == ShaderStageFlagBits::eCompute && cs.inputs.empty() && cs.bindings.size() == 3, "cull.spv is a compute shader");
+	for (uint32_t i = 0; i < cs.bindings.size(); i++) {
+		check(cs.bindings[i].set == 0 && cs.bindings[i].binding == i && cs.bindings[i].type == DescriptorType::eStorageBuffer
+			&& cs.bindings[i].count == 1, "cull.spv binds three storage buffers");
+	}
+	check(cs.pushConstants.size() == 1 && cs.pushConstants[0].offset == 0 && cs.pushConstants[0].size == 116
+		&& cs.pushConstantBlock == "cullView", "cull.spv pushes cullView");
+
+	// the layout the renderer uses for full vertices
+	const uint32_t stride = 32;
+	std::vector<vertexInputMatch> byLocation = {
+		{ 0, 0, Format::eR32G32B32Sfloat },
+		{ 1, 12, Format::eR32G32B32Sfloat },
+		{ 2, 24, Format::eR32G32Sfloat } };
+	VertexInputBindingDescription binding;
+	std::vector<VertexInputAttributeDescription> attributes;
+	check(buildVertexInput(vs, stride, byLocation, binding, attributes) && attributes.size() == 1
+		&& attributes[0].offset == 0 && attributes[0].format == Format::eR32G32B32Sfloat, "vert.spv binds by location");
+
+	std::vector<uint32_t> stripped = stripNames(vert);
+	shaderReflection bare;
+	check(stripped.size() < vert.size(), "vert.spv carries debug names to strip");
+	check(reflectSpirv(stripped.data(), stripped.size(), bare) && bare.inputs.size() == 1
+		&& bare.inputs[0].location == 0 && bare.inputs[0].name.empty(), "vert.spv reflects without debug names");
+	check(buildVertexInput(bare, stride, byLocation, binding, attributes) && attributes.size() == 1
+		&& attributes[0].offset == 0, "vert.spv binds without debug names");
+
+	// a name override wins over the location, and an unrelated name such as "distance" means nothing
+	shaderReflection named;
+	named.inputs = { { 0, Format::eR32G32B32Sfloat, "inPosition" }, { 1, Format::eR32Sfloat, "distance" } };
+	std::vector<vertexInputMatch> overridden = byLocation;
+	overridden.push_back({ 0, 28, Format::eR32Sfloat, "distance" });
+	check(buildVertexInput(named, stride, byLocation, binding, attributes) && attributes.size() == 2
+		&& attributes[1].offset == 12, "unrelated names do not change the match");
+	check(buildVertexInput(named, stride, overridden, binding, attributes) && attributes.size() == 2
+		&& attributes[0].offset == 0 && attributes[1].offset == 28, "a name override replaces the location match");
+	check(!buildVertexInput(bare, stride, overridden, binding, attributes), "name overrides refuse stripped modules");
+
+	if (passed) {
+		LOG_INFO("reflection self-test passed");
+	}
+	return passed;
+}
+
+void layoutCache::init(Device dev) {
+	device = dev;
+}
+
+void layoutCache::destroy() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& [key, layout] : pipelineLayouts) {
+		device.destroyPipelineLayout(layout);
+	}
+	for (auto& [key, layout] : setLayouts) {
+		device.destroyDescriptorSetLayout(layout);
+	}
+	pipelineLayouts.clear();
+	setLayouts.clear();
+}
+
+DescriptorSetLayout layoutCache::setLayout(const std::vector<DescriptorSetLayoutBinding>& bindings) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return setLayoutLocked(bindings);
+}
+
+DescriptorSetLayout layoutCache::setLayoutLocked(const std::vector<DescriptorSetLayoutBinding>& bindings) {
+	std::vector<uint32_t> key;
+	key.reserve(bindings.size() * 4);
+	for (const auto& b : bindings) {
+		key.insert(key.end(), { b.binding, static_cast<uint32_t>(b.descriptorType), b.descriptorCount,
+			static_cast<uint32_t>(b.stageFlags) });
+	}
+
+	auto found = setLayouts.find(key);
+	if (found != setLayouts.end()) {
+		return found->second;
+	}
+
+	DescriptorSetLayoutCreateInfo ci{ .bindingCount = static_cast<uint32_t>(bindings.size()),
+	.pBindings = bindings.data() };
+
+	DescriptorSetLayout layout = device.createDescriptorSetLayout(ci);
+	setLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+PipelineLayout layoutCache::pipelineLayout(const std::vector<const shaderReflection*>& stages) {
+	// merge per set, OR-ing the stages of bindings several shaders share
+	std::map<uint32_t, std::vector<DescriptorSetLayoutBinding>> sets;
+	ShaderStageFlags pushStages;
+	uint32_t pushBegin = UINT32_MAX, pushEnd = 0;
+
+	for (const shaderReflection* stage : stages) {
+		for (const auto& b : stage->bindings) {
+			auto& set = sets[b.set];
+			auto existing = std::find_if(set.begin(), set.end(), [&](const DescriptorSetLayoutBinding& other) {
+				return other.binding == b.binding;
+			});
+			if (existing != set.end()) {
+				existing->stageFlags |= b.stages;
+				existing->descriptorCount = std::max(existing->descriptorCount, b.count);
+			}
+			else {
+				set.push_back({ .binding = b.binding,
+				.descriptorType = b.type,
+				.descriptorCount = b.count,
+				.stageFlags = b.stages });
+			}
+		}
+		// one range covering every stage keeps vkCmdPushConstants a single call
+		for (const auto& range : stage->pushConstants) {
+			pushStages |= range.stageFlags;
+			pushBegin = std::min(pushBegin, range.offset);
+			pushEnd = std::max(pushEnd, range.offset + range.size);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// set numbers are positional, so gaps get an empty layout
+	std::vector<DescriptorSetLayout> layouts;
+	uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+	for (uint32_t i = 0; i < setCount; i++) {
+		auto& bindings = sets[i];
+		std::sort(bindings.begin(), bindings.end(), [](const DescriptorSetLayoutBinding& a, const DescriptorSetLayoutBinding& b) {
+			return a.binding < b.binding;
+		});
+		layouts.push_back(setLayoutLocked(bindings));
+	}
+
+	PushConstantRange pushRange{ .stageFlags = pushStages,
+	.offset = pushBegin == UINT32_MAX ? 0 : pushBegin,
+	.size = pushEnd > pushBegin ? pushEnd - pushBegin : 0 };
+	uint32_t pushCount = pushRange.size ? 1 : 0;
+
+	std::vector<uint64_t> key;
+	for (DescriptorSetLayout layout : layouts) {
+		key.push_back((uint64_t)(VkDescriptorSetLayout)layout);
+	}
+	key.insert(key.end(), { static_cast<uint32_t>(pushRange.stageFlags), pushRange.offset, pushRange.size });
+
+	auto found = pipelineLayouts.find(key);
+	if (found != pipelineLayouts.end()) {
+		return found->second;
+	}
+
+	PipelineLayoutCreateInfo ci{ .setLayoutCount = static_cast<uint32_t>(layouts.size()),
+	.pSetLayouts = layouts.data(),
+	.pushConstantRangeCount = pushCount,
+	.pPushConstantRanges = pushCount ? &pushRange : nullptr };
+
+	PipelineLayout layout = device.createPipelineLayout(ci);
+	pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+size_t layoutCache::setLayoutCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return setLayouts.size();
+}
+
+size_t layoutCache::pipelineLayoutCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pipelineLayouts.size();
+}
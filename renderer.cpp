@@ -8,22 +8,40 @@
 #include <optional>
 #include <vector>
 #include <vulkan/vulkan.hpp>
-#include <iostream>
+#include <cstring>
 #include <fstream>
+#include <algorithm>
 #include <array>
+#include <filesystem>
+#include <set>
 #include "renderer.h"
+#include "log.h"
+#include "mesh.h"
+#include "meshcache.h"
+#include "lod.h"
+#include "meshlet.h"
+#include "meshopt.h"
+#include "objparser.h"
+#include "pacing.h"
 
 
 using namespace vk;
 
 Buffer vb;
 
-DeviceMemory vbMem;
+allocation vbMem;
+
+Buffer ib;
+
+allocation ibMem;
+
+IndexType indexType;
 
 const std::vector<const char*> deviceExt = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 struct QueueFamilyIndices {
 	std::optional<uint32_t> gfxFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily;
 
 	bool isComplete() {
 		return gfxFamily.has_value() && presentFamily.has_value();
@@ -35,94 +53,133 @@ QueueFamilyIndices findQueueFamilies(PhysicalDevice device, SurfaceKHR surface)
 
 	int i = 0;
 	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueCount > 0 && queueFamily.queueFlags & QueueFlagBits::eGraphics) {
+		if (!indices.gfxFamily && queueFamily.queueCount > 0 && queueFamily.queueFlags & QueueFlagBits::eGraphics) {
 			indices.gfxFamily = i;
 		}
-		if (queueFamily.queueCount > 0 && device.getSurfaceSupportKHR(i, surface)) {
+		if (!indices.presentFamily && queueFamily.queueCount > 0 && surface && device.getSurfaceSupportKHR(i, surface)) {
 			indices.presentFamily = i;
 		}
-		if (indices.isComplete()) {
-			break;
+		// a transfer-only family maps to the copy engines and runs uploads beside rendering
+		if (!indices.transferFamily && queueFamily.queueCount > 0 && queueFamily.queueFlags & QueueFlagBits::eTransfer
+			&& !(queueFamily.queueFlags & (QueueFlagBits::eGraphics | QueueFlagBits::eCompute))) {
+			indices.transferFamily = i;
 		}
 		i++;
 	}
+	if (!indices.transferFamily) {
+		indices.transferFamily = indices.gfxFamily;
+	}
+	// headless never presents
+	if (!surface) {
+		indices.presentFamily = indices.gfxFamily;
+	}
 	return indices;
 }
-uint32_t findMemType(PhysicalDevice gpu, uint32_t typeFilter, MemoryPropertyFlags
-	properties) {
-	PhysicalDeviceMemoryProperties memProperties;
-	memProperties =  gpu.getMemoryProperties();
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
-	}
-
-}
-struct Vertex {
-	glm::vec2 pos;
-};
-
-std::vector<Vertex> vertices;
-VertexInputBindingDescription bindingDesc{
-	.binding = 0,
-	.stride = sizeof(Vertex),
-	.inputRate = VertexInputRate::eVertex
-};
-
-std::array<VertexInputAttributeDescription, 1> attribDesc{
-
-attribDesc[0].binding = 0,
-attribDesc[0].location = 0,
-attribDesc[0].format = Format::eR32G32Sfloat,
-attribDesc[0].offset = offsetof(Vertex, pos)
-};
+mesh model;
+cachedMesh modelCache;
+meshView geometry;
 
 void renderer::init() {
 	createInstance();
 	createSurface();
 	selectGpu();
 	createDevice();
+	createAllocator();
 
-	createSwapchain();
+	if (headless) {
+		createOffscreenTargets();
+	}
+	else {
+		createSwapchain();
+	}
 	createImageViews();
 	createRenderPass();
+	createPipelineCache();
 	createPipeline();
+	createHotReload();
 	createFramebuffers();
 	loadModel();
 	createCommandPool();
+	createProfiler();
+	createUploadRing();
 	createVertexBuffer();
+	createIndexBuffer();
+	createMeshletCulling();
+	// the first frame waits for these copies on the GPU through the upload timeline
+	uploads.submit();
+	buildDrawList();
 	createCommandBuffers();
+	createTransientBuffers();
 
 	createSemaphores();
-	createFence();
+	createTimeline();
 }
 void renderer::cleanup() {
-	device->destroyFence(fence);
-	device->destroySemaphore(renderSemaphore);
-	device->destroySemaphore(imgSemaphore);
+	for (auto& item : garbage) {
+		item.destroy();
+	}
+	garbage.clear();
 
+	device->destroySemaphore(frameTimeline);
+	gpuProfile.destroy();
 
-	device->freeCommandBuffers(commandPool, commandBuffers);
+	for (auto& semaphore : renderSemaphores) {
+		device->destroySemaphore(semaphore);
+	}
 
-	device->destroyCommandPool(commandPool);
+	for (auto& frame : frames) {
+		device->destroySemaphore(frame.acquired);
+		device->destroyCommandPool(frame.pool);
+		for (auto& pool : frame.workerPools) {
+			device->destroyCommandPool(pool);
+		}
+		device->destroyBuffer(frame.transient.buffer);
+		allocator.free(frame.transient.memory);
+	}
 
 	for (auto& framebuffer : framebuffers) {
 		device->destroyFramebuffer(framebuffer);
 	}
 
-	device->destroyPipeline(pipeline);
-	device->destroyPipelineLayout(pipelineLayout);
+	shaderReload.destroy();
+	meshletCull.destroy();
+	pipelines.destroy();
+	layouts.destroy();
+	shaders.destroy();
+	pipelineCache.save();
+	pipelineCache.destroy();
 	device->destroyRenderPass(rp);
 
 	for (auto& imageView : imageViews) {
 		device->destroyImageView(imageView);
 	}
 
-	device->destroySwapchainKHR(swapchain);
+	if (headless) {
+		for (size_t i = 0; i < images.size(); i++) {
+			device->destroyImage(images[i]);
+			allocator.free(offscreenMemory[i]);
+		}
+		for (size_t i = 0; i < readbackBuffers.size(); i++) {
+			device->destroyBuffer(readbackBuffers[i]);
+			allocator.free(readbackMemory[i]);
+		}
+	}
+	else {
+		device->destroySwapchainKHR(swapchain);
+	}
+	uploads.destroy();
 	device->destroyBuffer(vb);
-	device->freeMemory(vbMem);
+	allocator.free(vbMem);
+	device->destroyBuffer(ib);
+	allocator.free(ibMem);
+	if (meshletBuffer) {
+		device->destroyBuffer(meshletBuffer);
+		allocator.free(meshletMemory);
+	}
+	allocator.destroy();
+	if (headless) {
+		return;
+	}
 	instance->destroySurfaceKHR(surface);
 
 	glfwDestroyWindow(window);
@@ -131,7 +188,9 @@ void renderer::cleanup() {
 }
 void renderer::update() {
 	while (!glfwWindowShouldClose(window)) {
+		pacer.sleepUntilInput();
 		glfwPollEvents();
+		pacer.inputSampled();
 		 render();
 
 	}
@@ -139,19 +198,29 @@ void renderer::update() {
 }
 
 void renderer::windowInit() {
+	if (headless) {
+		return;
+	}
 	glfwInit();
 	
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
 	window = glfwCreateWindow(width, height, "Vulkan triangle", nullptr, nullptr);
 
+	glfwSetWindowUserPointer(window, this);
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow* w, int, int) {
+		static_cast<renderer*>(glfwGetWindowUserPointer(w))->framebufferResized = true;
+	});
 }
 
 bool renderer::createInstance() {
 	uint32_t glfwExtCount = 0;
-	const char** glfwExt;
+	const char** glfwExt = nullptr;
 
-	glfwExt = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+	// headless needs no surface extensions, and GLFW is never initialised
+	if (!headless) {
+		glfwExt = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+	}
 	std::vector<const char*> ext(glfwExt, glfwExt
 		+ glfwExtCount);
 
@@ -171,7 +240,7 @@ bool renderer::createInstance() {
 	};
 	instance = createInstanceUnique(ci);
 
-	std::cout << "instance created" << std::endl;
+	LOG_INFO("instance created");
 
 	return true;
 }
@@ -181,7 +250,7 @@ bool renderer::selectGpu() {
 
 	gpu = gpus.front();
 
-	std::cout << "gpu selected" << std::endl;
+	LOG_INFO("gpu selected");
 	return true;
 }
 
@@ -191,43 +260,81 @@ bool renderer::selectGpu() {
 
 bool renderer::createDevice() {
 	auto features = PhysicalDeviceFeatures();
+	// optional: lets a submesh's visible meshlets go out as one indirect draw
+	features.multiDrawIndirect = gpu.getFeatures().multiDrawIndirect;
+	scene.multiDrawIndirect = features.multiDrawIndirect;
+	PhysicalDeviceVulkan12Features features12{ .timelineSemaphore = VK_TRUE };
 	float priority = 1.0f;
-	DeviceQueueCreateInfo ci{
-		.queueFamilyIndex = 0,
-		.queueCount = 1,
-		.pQueuePriorities = &priority
+
+	QueueFamilyIndices indices = findQueueFamilies(gpu, surface);
+	gfxFamily = indices.gfxFamily.value();
+	transferFamily = indices.transferFamily.value();
+
+	std::set<uint32_t> families = { gfxFamily, indices.presentFamily.value(), transferFamily };
+	std::vector<DeviceQueueCreateInfo> queueCis;
+	for (uint32_t family : families) {
+		queueCis.push_back({
+			.queueFamilyIndex = family,
+			.queueCount = 1,
+			.pQueuePriorities = &priority
+		});
+	}
+
+	std::vector<const char*> extensions = headless ? std::vector<const char*>() : deviceExt;
+
+#ifdef VK_EXT_shader_module_identifier
+	// optional: lets the shader registry keep driver identifiers for its modules
+	PhysicalDeviceShaderModuleIdentifierFeaturesEXT identifierFeatures{ .shaderModuleIdentifier = VK_TRUE };
+	auto supported = gpu.enumerateDeviceExtensionProperties();
+	auto hasExtension = [&](const char* name) {
+		return std::any_of(supported.begin(), supported.end(), [&](const ExtensionProperties& ext) {
+			return strcmp(ext.extensionName.data(), name) == 0;
+		});
 	};
+	if (hasExtension(VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME)
+		&& hasExtension(VK_EXT_PIPELINE_CREATION_CACHE_CONTROL_EXTENSION_NAME)) {
+		auto chain = gpu.getFeatures2<PhysicalDeviceFeatures2, PhysicalDeviceShaderModuleIdentifierFeaturesEXT>();
+		if (chain.get<PhysicalDeviceShaderModuleIdentifierFeaturesEXT>().shaderModuleIdentifier) {
+			extensions.push_back(VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_PIPELINE_CREATION_CACHE_CONTROL_EXTENSION_NAME);
+			features12.pNext = &identifierFeatures;
+			shaderIdentifiers = true;
+		}
+	}
+#endif
+
 	DeviceCreateInfo deviceCi{
-		.queueCreateInfoCount = 1,
-		.pQueueCreateInfos = &ci,
-		.enabledExtensionCount = static_cast<uint32_t>(deviceExt.size()),
-		.ppEnabledExtensionNames = deviceExt.data(),
+		.pNext = &features12,
+		.queueCreateInfoCount = static_cast<uint32_t>(queueCis.size()),
+		.pQueueCreateInfos = queueCis.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+		.ppEnabledExtensionNames = extensions.data(),
 		.pEnabledFeatures = &features
 	};
 
 	device = gpu.createDeviceUnique(deviceCi);
 
-	uint32_t queueGfxFamilyIndex = 0;
-
-	
-
-	
-
-	gfxQueue = device->getQueue(findQueueFamilies(gpu, surface).gfxFamily.value(), 0);
-	presentQueue = device->getQueue(findQueueFamilies(gpu, surface).presentFamily.value(), 0);
-	std::cout << "device created" << std::endl;
+	gfxQueue = device->getQueue(gfxFamily, 0);
+	presentQueue = device->getQueue(indices.presentFamily.value(), 0);
+	transferQueue = device->getQueue(transferFamily, 0);
+	shaders.init(*device, shaderIdentifiers);
+	layouts.init(*device);
+	LOG_INFO("device created");
 	return true;
 }
 
 bool renderer::createSurface() {
+	if (headless) {
+		return true;
+	}
 	VkSurfaceKHR surf;
 	VkResult result;
  	result = glfwCreateWindowSurface((VkInstance)*instance, window, nullptr, &surf);
 
-	std::cout << "result is " << result << std::endl;
+	LOG_DEBUG("surface result " << result);
 
 	surface = static_cast<SurfaceKHR>(surf);
-	std::cout << "surface created" << std::endl;
+	LOG_INFO("surface created");
 	return true;
 }
 
@@ -236,27 +343,198 @@ bool renderer::createSwapchain() {
 
 	caps = gpu.getSurfaceCapabilitiesKHR(surface);
 
+	// UINT32_MAX means the surface takes whatever size the swapchain picks
+	if (caps.currentExtent.width != UINT32_MAX) {
+		extent = caps.currentExtent;
+	}
+	else {
+		int w, h;
+		glfwGetFramebufferSize(window, &w, &h);
+		extent.width = std::clamp(static_cast<uint32_t>(w), caps.minImageExtent.width, caps.maxImageExtent.width);
+		extent.height = std::clamp(static_cast<uint32_t>(h), caps.minImageExtent.height, caps.maxImageExtent.height);
+	}
+
+	presentMode = choosePresentMode(gpu.getSurfacePresentModesKHR(surface), presentPreference);
+
+	// mailbox needs a spare image to replace; maxImageCount 0 means unbounded
+	uint32_t imageCount = swapchainImageCount ? swapchainImageCount : caps.minImageCount + 1;
+	imageCount = std::max(imageCount, caps.minImageCount);
+	if (caps.maxImageCount > 0) {
+		imageCount = std::min(imageCount, caps.maxImageCount);
+	}
+
 	SwapchainCreateInfoKHR ci{ .surface = surface,
-	.minImageCount = caps.minImageCount,
+	.minImageCount = imageCount,
 	.imageFormat = Format::eB8G8R8A8Srgb,
 	.imageColorSpace = ColorSpaceKHR::eSrgbNonlinear,
-	.imageExtent = caps.currentExtent,
+	.imageExtent = extent,
 	.imageArrayLayers = 1,
 	.imageUsage = ImageUsageFlagBits::eColorAttachment,
 	.imageSharingMode = SharingMode::eExclusive,
-	.presentMode = PresentModeKHR::eFifo,
+	.presentMode = presentMode,
 	.clipped = true,
-	.oldSwapchain = SwapchainKHR(nullptr) };
+	.oldSwapchain = swapchain };
 
 	swapchain = device->createSwapchainKHR(ci);
 
 	images = device->getSwapchainImagesKHR(swapchain);
 
-	std::cout << "swapchain created" << std::endl;
+	LOG_INFO("swapchain created: " << images.size() << " images, " << to_string(presentMode));
 
 	return true;
 }
 
+bool renderer::createOffscreenTargets() {
+	images.resize(framesInFlight);
+	offscreenMemory.resize(framesInFlight);
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		ImageCreateInfo ci{ .imageType = ImageType::e2D,
+		.format = Format::eB8G8R8A8Srgb,
+		.extent = { extent.width, extent.height, 1 },
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = SampleCountFlagBits::e1,
+		.tiling = ImageTiling::eOptimal,
+		.usage = ImageUsageFlagBits::eColorAttachment | ImageUsageFlagBits::eTransferSrc,
+		.sharingMode = SharingMode::eExclusive,
+		.initialLayout = ImageLayout::eUndefined };
+
+		images[i] = device->createImage(ci);
+
+		ImageMemoryRequirementsInfo2 reqInfo{ .image = images[i] };
+		auto reqs = device->getImageMemoryRequirements2<MemoryRequirements2, MemoryDedicatedRequirements>(reqInfo);
+		const MemoryRequirements& memReq = reqs.get<MemoryRequirements2>().memoryRequirements;
+		bool dedicated = reqs.get<MemoryDedicatedRequirements>().prefersDedicatedAllocation;
+
+		if (!allocator.allocate(memReq, MemoryPropertyFlagBits::eDeviceLocal, resourceKind::optimal, dedicated,
+			offscreenMemory[i], nullptr, images[i])) {
+			throw OutOfDeviceMemoryError("no memory type can hold the offscreen target");
+		}
+		device->bindImageMemory(images[i], offscreenMemory[i].memory, offscreenMemory[i].offset);
+	}
+
+	if (captureFrames) {
+		readbackBuffers.resize(framesInFlight);
+		readbackMemory.resize(framesInFlight);
+		for (uint32_t i = 0; i < framesInFlight; i++) {
+			createBuffer(DeviceSize(extent.width) * extent.height * 4, BufferUsageFlagBits::eTransferDst,
+				MemoryPropertyFlagBits::eHostVisible | MemoryPropertyFlagBits::eHostCoherent,
+				readbackBuffers[i], readbackMemory[i]);
+		}
+	}
+
+	LOG_INFO("offscreen targets created: " << images.size() << " images, " << extent.width << "x" << extent.height);
+
+	return true;
+}
+
+void renderer::recordReadback(CommandBuffer cmd, uint32_t imgIndex) {
+	// the render pass leaves the image in transfer-src layout when headless
+	BufferImageCopy region{ .bufferOffset = 0,
+	.bufferRowLength = 0,
+	.bufferImageHeight = 0,
+	.imageSubresource = {.aspectMask = ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+	.imageOffset = { 0, 0, 0 },
+	.imageExtent = { extent.width, extent.height, 1 } };
+
+	cmd.copyImageToBuffer(images[imgIndex], ImageLayout::eTransferSrcOptimal, readbackBuffers[imgIndex], region);
+
+	MemoryBarrier toHost{ .srcAccessMask = AccessFlagBits::eTransferWrite, .dstAccessMask = AccessFlagBits::eHostRead };
+	cmd.pipelineBarrier(PipelineStageFlagBits::eTransfer, PipelineStageFlagBits::eHost, {}, toHost, nullptr, nullptr);
+}
+
+bool renderer::readback(std::vector<uint8_t>& rgba) {
+	if (!headless || !captureFrames || frameCounter == 0) {
+		return false;
+	}
+
+	uint64_t submitted = frames[lastFrameIndex].submitted;
+	SemaphoreWaitInfo waitInfo{ .semaphoreCount = 1, .pSemaphores = &frameTimeline, .pValues = &submitted };
+	device->waitSemaphores(waitInfo, UINT64_MAX);
+
+	// offscreen images are BGRA
+	size_t pixels = size_t(extent.width) * extent.height;
+	const uint8_t* src = static_cast<const uint8_t*>(readbackMemory[lastFrameIndex].mapped);
+	rgba.resize(pixels * 4);
+	for (size_t i = 0; i < pixels; i++) {
+		rgba[i * 4 + 0] = src[i * 4 + 2];
+		rgba[i * 4 + 1] = src[i * 4 + 1];
+		rgba[i * 4 + 2] = src[i * 4 + 0];
+		rgba[i * 4 + 3] = src[i * 4 + 3];
+	}
+	return true;
+}
+
+double renderer::runHeadless(uint32_t frameCount) {
+	auto start = framePacer::clock::now();
+	for (uint32_t i = 0; i < frameCount; i++) {
+		render();
+	}
+	device->waitIdle();
+	std::chrono::duration<double, std::milli> elapsed = framePacer::clock::now() - start;
+
+	double frameMs = frameCount ? elapsed.count() / frameCount : 0.0;
+	LOG_INFO("headless: " << frameCount << " frames, " << frameMs << " ms per frame, "
+		<< pacer.stats().recordMs << " ms recording");
+	// the compute pass leaves its counts in the last frame's commands
+	bool culledOnGpu = meshletCull.results(lastFrameIndex, frames[lastFrameIndex].transient, visibleMeshlets, drawnTriangles);
+	LOG_INFO("  geometry: " << drawnTriangles << " triangles, " << visibleMeshlets << " of "
+		<< geometry.meshletCount << " meshlets visible"
+		<< (!meshletCulling ? "" : culledOnGpu ? ", culled on the GPU" : ", culled on the CPU"));
+	for (auto& zone : cpuProfile.stats()) {
+		LOG_INFO("  cpu " << zone.name << ": avg " << zone.avgMs << " ms, max " << zone.maxMs
+			<< " ms, " << zone.lastCalls << " calls");
+	}
+	for (auto& region : gpuProfile.stats()) {
+		LOG_INFO("  gpu " << region.name << ": avg " << region.avgMs << " ms, min " << region.minMs
+			<< " ms, p99 " << region.p99Ms << " ms");
+	}
+
+	return frameMs;
+}
+
+void renderer::recreateSwapchain() {
+	// a minimized window has a zero-sized surface; nothing can be presented until it comes back
+	int w = 0, h = 0;
+	glfwGetFramebufferSize(window, &w, &h);
+	while ((w == 0 || h == 0) && !glfwWindowShouldClose(window)) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &w, &h);
+	}
+	if (w == 0 || h == 0) {
+		return;
+	}
+	framebufferResized = false;
+
+	SwapchainKHR oldSwapchain = swapchain;
+	std::vector<ImageView> oldImageViews = std::move(imageViews);
+	std::vector<Framebuffer> oldFramebuffers = std::move(framebuffers);
+	std::vector<Semaphore> oldRenderSemaphores = std::move(renderSemaphores);
+
+	// pipelines use dynamic viewport/scissor and the render pass only depends on the format,
+	// so only the size-dependent objects are rebuilt
+	createSwapchain();
+	createImageViews();
+	createFramebuffers();
+	createRenderSemaphores();
+
+	// frames still in flight may reference the old objects
+	Device dev = *device;
+	deferDestroy([dev, oldSwapchain, oldImageViews, oldFramebuffers, oldRenderSemaphores]() {
+		for (auto& framebuffer : oldFramebuffers) {
+			dev.destroyFramebuffer(framebuffer);
+		}
+		for (auto& imageView : oldImageViews) {
+			dev.destroyImageView(imageView);
+		}
+		for (auto& semaphore : oldRenderSemaphores) {
+			dev.destroySemaphore(semaphore);
+		}
+		dev.destroySwapchainKHR(oldSwapchain);
+	});
+}
+
 bool renderer::createImageViews() {
 	imageViews.resize(images.size());
 
@@ -279,23 +557,11 @@ bool renderer::createImageViews() {
 		imageViews[i] = device->createImageView(ci);
 
 	}
-	std::cout << "image views created" << std::endl;
+	LOG_INFO("image views created");
 
 	return true;
 }
 
-ShaderModule renderer::createShaderModule(const std::vector<char>& code) {
-
-	ShaderModuleCreateInfo ci{ .codeSize = code.size(),
-	.pCode = reinterpret_cast<const uint32_t*>(code.data()) };
-
-	ShaderModule shaderModule;
-	shaderModule = device->createShaderModule(ci);
-
-	std::cout << "shader module created" << std::endl;
-
-	return shaderModule;
-}
 
 bool renderer::createRenderPass() {
 
@@ -306,7 +572,7 @@ bool renderer::createRenderPass() {
 	.stencilLoadOp = AttachmentLoadOp::eDontCare,
 	.stencilStoreOp = AttachmentStoreOp::eDontCare,
 	.initialLayout = ImageLayout::eUndefined,
-	.finalLayout = ImageLayout::ePresentSrcKHR };
+	.finalLayout = headless ? ImageLayout::eTransferSrcOptimal : ImageLayout::ePresentSrcKHR };
 
 	AttachmentReference colorAttachmentRef{ .attachment = 0,
 	.layout = ImageLayout::eColorAttachmentOptimal };
@@ -315,12 +581,23 @@ bool renderer::createRenderPass() {
 	.colorAttachmentCount = 1,
 	.pColorAttachments = &colorAttachmentRef };
 
-	SubpassDependency dependency{
-		.srcSubpass = VK_SUBPASS_EXTERNAL,
-		.dstSubpass = 0,
-		.srcStageMask = PipelineStageFlagBits::eColorAttachmentOutput,
-		.dstStageMask = PipelineStageFlagBits::eColorAttachmentOutput,
-		.dstAccessMask = AccessFlagBits::eColorAttachmentWrite
+	SubpassDependency dependencies[] = {
+		{
+			.srcSubpass = VK_SUBPASS_EXTERNAL,
+			.dstSubpass = 0,
+			.srcStageMask = PipelineStageFlagBits::eColorAttachmentOutput,
+			.dstStageMask = PipelineStageFlagBits::eColorAttachmentOutput,
+			.dstAccessMask = AccessFlagBits::eColorAttachmentWrite
+		},
+		// headless frames are copied out by recordReadback right after the pass ends
+		{
+			.srcSubpass = 0,
+			.dstSubpass = VK_SUBPASS_EXTERNAL,
+			.srcStageMask = PipelineStageFlagBits::eColorAttachmentOutput,
+			.dstStageMask = PipelineStageFlagBits::eTransfer,
+			.srcAccessMask = AccessFlagBits::eColorAttachmentWrite,
+			.dstAccessMask = AccessFlagBits::eTransferRead
+		}
 	};
 
 	PipelineLayout pipelineLayout;
@@ -330,64 +607,136 @@ bool renderer::createRenderPass() {
 		.pAttachments = &colorAttachment,
 		.subpassCount = 1,
 		.pSubpasses = &subpass,
-		.dependencyCount = 1,
-		.pDependencies = &dependency
+		.dependencyCount = headless ? 2u : 1u,
+		.pDependencies = dependencies
 	};
 
 	rp = device->createRenderPass(ci);
 
-	std::cout << "render pass created" << std::endl;
+	LOG_INFO("render pass created");
 
 	return true;
 }
 
-std::vector<char> renderer::readSpv(const std::string filename) {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
-	size_t fileSize = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(fileSize);
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
 
-	file.close();
-	std::cout << "SPV INFO --------------------" << std::endl;
-	std::cout << "buffer of shader file size is: " << fileSize << " and filename: " << filename << std::endl;
+void renderer::createBuffer(DeviceSize size, BufferUsageFlags usage, MemoryPropertyFlags properties,
+	Buffer& buffer, allocation& memory) {
+	// geometry is read by the graphics queue but written by the transfer queue
+	uint32_t families[] = { gfxFamily, transferFamily };
+	bool shared = gfxFamily != transferFamily;
+
+	BufferCreateInfo bufferInfo{
+		.size = size,
+		.usage = usage,
+		.sharingMode = shared ? SharingMode::eConcurrent : SharingMode::eExclusive,
+		.queueFamilyIndexCount = shared ? 2u : 0u,
+		.pQueueFamilyIndices = shared ? families : nullptr
+	};
+
+	buffer = device->createBuffer(bufferInfo);
+
+	BufferMemoryRequirementsInfo2 reqInfo{ .buffer = buffer };
+	auto reqs = device->getBufferMemoryRequirements2<MemoryRequirements2, MemoryDedicatedRequirements>(reqInfo);
+
+	const MemoryRequirements& memReq = reqs.get<MemoryRequirements2>().memoryRequirements;
+	bool dedicated = reqs.get<MemoryDedicatedRequirements>().prefersDedicatedAllocation;
+
+	if (!allocator.allocate(memReq, properties, resourceKind::linear, dedicated, memory, buffer)) {
+		throw OutOfDeviceMemoryError("no memory type can hold the buffer");
+	}
 
-	return buffer;
+	device->bindBufferMemory(buffer, memory.memory, memory.offset);
+}
 
+void renderer::createAllocator() {
+	memBackend.init(*device, gpu);
+	allocator.init(&memBackend);
 
+	LOG_INFO("allocator created");
 }
 
+void renderer::createUploadRing() {
+	const DeviceSize stagingSize = 32 * 1024 * 1024;
 
+	uploads.init(*device, allocator, transferQueue, transferFamily, stagingSize);
+}
 
 void renderer::createVertexBuffer() {
-	BufferCreateInfo bufferInfo{
-		.size = sizeof(vertices[0]) * vertices.size(),
-		.usage = BufferUsageFlagBits::eVertexBuffer,
-		.sharingMode = SharingMode::eExclusive
-	};
+	const void* data = geometry.vertices;
+	DeviceSize size = sizeof(Vertex) * geometry.vertexCount;
 
-	vb = device->createBuffer(bufferInfo);
+	if (vertexFormat == vertexEncoding::quantized) {
+		packedGeometry = quantizeMesh(geometry);
+		data = packedGeometry.vertices.data();
+		size = sizeof(packedVertex) * packedGeometry.vertices.size();
+	}
 
-	MemoryRequirements memReq;
+	createBuffer(size, BufferUsageFlagBits::eVertexBuffer | BufferUsageFlagBits::eTransferDst,
+		MemoryPropertyFlagBits::eDeviceLocal, vb, vbMem);
 
-	memReq = device->getBufferMemoryRequirements(vb);
+	uploads.uploadBuffer(vb, 0, data, size);
+	// the staging ring holds a copy now
+	packedGeometry.vertices = {};
 
-	MemoryAllocateInfo allocInfo{
-		.allocationSize = memReq.size,
-		.memoryTypeIndex = findMemType(gpu,memReq.memoryTypeBits, MemoryPropertyFlagBits::eHostVisible | MemoryPropertyFlagBits::eHostCoherent)
+	LOG_INFO("vertex buffer created: " << size / 1024 << " KB, "
+		<< (vertexFormat == vertexEncoding::quantized ? "quantized" : "full") << " vertices");
+}
 
-	};
-	vbMem = device->allocateMemory(allocInfo);
+void renderer::createIndexBuffer() {
+	// quantized indices restart at every submesh, so only the largest submesh has to fit in 16 bits
+	const void* data = geometry.indices;
+	size_t srcIndexSize = geometry.indexSize;
+	uint32_t addressed = geometry.vertexCount;
+	if (vertexFormat == vertexEncoding::quantized) {
+		data = packedGeometry.indices.data();
+		srcIndexSize = sizeof(uint32_t);
+		addressed = packedGeometry.maxSubmeshVertices;
+	}
 
-	device->bindBufferMemory(vb, vbMem, 0);
+	indexType = addressed <= UINT16_MAX ? IndexType::eUint16 : IndexType::eUint32;
+	size_t indexSize = indexType == IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	DeviceSize size = indexSize * geometry.indexCount;
 
-	uint8_t* data = static_cast<uint8_t*>(device->mapMemory(vbMem, 0, memReq.size));
-	memcpy(data, vertices.data(), static_cast<size_t>(bufferInfo.size));
-	device->unmapMemory(vbMem);
+	createBuffer(size, BufferUsageFlagBits::eIndexBuffer | BufferUsageFlagBits::eTransferDst,
+		MemoryPropertyFlagBits::eDeviceLocal, ib, ibMem);
 
+	if (srcIndexSize == indexSize) {
+		uploads.uploadBuffer(ib, 0, data, size);
+	}
+	else {
+		const uint32_t* src = static_cast<const uint32_t*>(data);
+		std::vector<uint16_t> narrowed(src, src + geometry.indexCount);
+		uploads.uploadBuffer(ib, 0, narrowed.data(), size);
+	}
+
+	packedGeometry.indices = {};
+
+	LOG_INFO("index buffer created: " << geometry.indexCount << " indices, "
+		<< geometry.vertexCount << " unique vertices");
+}
+
+void renderer::createMeshletCulling() {
+	if (!meshletCulling || !gpuMeshletCulling || geometry.meshletCount == 0) {
+		return;
+	}
+	// without multi-draw every meshlet, culled or not, would cost an indirect draw call of its own
+	if (!scene.multiDrawIndirect || !(gpu.getQueueFamilyProperties()[gfxFamily].queueFlags & QueueFlagBits::eCompute)) {
+		LOG_INFO("meshlet culling stays on the CPU: needs multiDrawIndirect and compute on the graphics queue");
+		return;
+	}
+	if (!meshletCull.init(*device, gpu.getProperties().limits, pipelineCache.cache(), shaders, layouts, framesInFlight)) {
+		return;
+	}
 
+	// never changes with the vertex encoding, so it outlives vertex shader reloads
+	DeviceSize size = sizeof(meshlet) * geometry.meshletCount;
+	createBuffer(size, BufferUsageFlagBits::eStorageBuffer | BufferUsageFlagBits::eTransferDst,
+		MemoryPropertyFlagBits::eDeviceLocal, meshletBuffer, meshletMemory);
+	uploads.uploadBuffer(meshletBuffer, 0, geometry.meshlets, size);
+
+	LOG_INFO("meshlet buffer created: " << geometry.meshletCount << " meshlets");
 }
 
 
@@ -404,128 +753,157 @@ void renderer::loadModel() {
 
 		const std::string MODEL_PATH = "models/p1.obj";
 
+		if (loadMeshCache(MODEL_PATH, modelCache)) {
+			geometry = modelCache.view;
+			return;
+		}
+
 		attrib_t attrib;
 		std::vector<shape_t> shapes;
+		std::vector<material_t> materials;
+		std::string warn, err;
 		// materials later
-		LoadObj(&attrib, &shapes, nullptr, nullptr, nullptr, MODEL_PATH.c_str());
-
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-
-				Vertex vertex{
-
-				};
-				vertex.pos = {
-	   attrib.vertices[3 * index.vertex_index + 0],
-	  attrib.vertices[3 * index.vertex_index + 1]
-
-				};
-				vertices.push_back(vertex);
-
-			}
+		if (!loadObjParallel(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str(), "models/", workers)) {
+			LOG_ERROR("failed to load " << MODEL_PATH << ": " << err);
+			return;
 		}
 
+		model = buildMesh(attrib, shapes);
+		// reordered once here; the cache stores the optimized order
+		meshOptimizeStats order = optimizeMesh(model);
+		LOG_INFO("mesh reordered: ACMR " << order.before.acmr << " -> " << order.after.acmr
+			<< ", ATVR " << order.before.atvr << " -> " << order.after.atvr);
+		// split after reordering, so meshlets follow the cache-friendly triangle order
+		buildMeshlets(model);
+		LOG_INFO("meshlets built: " << model.meshlets.size() << " for " << model.indices.size() / 3 << " triangles");
+		size_t fullIndices = model.indices.size();
+		buildLods(model);
+		LOG_INFO("LODs built: " << model.lods.size() - model.submeshes.size() << " levels below full detail, "
+			<< (model.indices.size() - fullIndices) / 3 << " extra triangles");
+		geometry = model.view();
+
+		writeMeshCache(MODEL_PATH, model);
 	
 }
 
 
-bool renderer::createPipeline() {
-	auto vertCode = readSpv("shaders/vert.spv");
-	auto fragCode = readSpv("shaders/frag.spv");
-
-	ShaderModule vertModule = createShaderModule(vertCode);
-	ShaderModule fragModule = createShaderModule(fragCode);
-
-	PipelineShaderStageCreateInfo vCi{ .stage = ShaderStageFlagBits::eVertex,
-	.module = vertModule,
-	.pName = "main" };
-
-	PipelineShaderStageCreateInfo fCi{ .stage = ShaderStageFlagBits::eFragment,
-	.module = fragModule,
-	.pName = "main" };
-
-	PipelineShaderStageCreateInfo shaderStages[] = { vCi, fCi };
+bool renderer::createPipelineCache() {
+	pipelineCache.init(*device, gpu, "pipelines.cache");
 
-	PipelineVertexInputStateCreateInfo vi{ .vertexBindingDescriptionCount = 1,
-	.pVertexBindingDescriptions = &bindingDesc,
-	.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribDesc.size()),
-	.pVertexAttributeDescriptions = attribDesc.data()};
-
-
-	PipelineInputAssemblyStateCreateInfo ia{ .topology = PrimitiveTopology::eTriangleList };
-
-	Viewport vp{};
-	vp.x = 		 0.0f;
-	vp.width = (float)extent.width;
-	vp.height = -(float)extent.height;
-	vp.y = extent.height;
-	vp.minDepth = 0.0f;
-	vp.maxDepth = 1.0f;
+	return true;
+}
 
-	Rect2D scissor{};
+bool renderer::createPipeline() {
+	// compiles run beside the recording workers, so half the cores keep a compile burst from stalling frames
+	pipelines.init(*device, pipelineCache, shaders, layouts, std::max(1u, workers.size() / 2));
 
-	scissor.extent = extent;
+	selectVertexShader();
 
-	PipelineViewportStateCreateInfo viewport{
-		.viewportCount = 1,
-		.pViewports = &vp,
-		.scissorCount = 1,
-		.pScissors = &scissor
-	};
+	// shader inputs are bound to vertex attributes by name
+	vertexLayout layout = vertexLayout::make(vertexFormat);
+	pipelines.setTarget(rp, layout.stride, layout.attributes);
 
-	PipelineRasterizationStateCreateInfo rs{
-		.polygonMode = PolygonMode::eFill,
-		.cullMode = CullModeFlagBits::eBack,
-		.frontFace = FrontFace::eClockwise,
-		.lineWidth = 1.0f
-	};
+	// the fallback for every later permutation, so the first frame waits for it
+	defaultPipeline = pipelines.request({ .vertexShader = vertexShader, .fragmentShader = "shaders/frag.spv" });
+	pipeline = pipelines.wait(defaultPipeline);
+	pipelineLayout = pipelines.layout(defaultPipeline);
 
-	ColorComponentFlags flags = ColorComponentFlagBits::eR | ColorComponentFlagBits::eG | ColorComponentFlagBits::eB
-		| ColorComponentFlagBits::eA;
-
-	PipelineColorBlendAttachmentState colorBlendAttachment{
-		.blendEnable = VK_FALSE,
-		.srcColorBlendFactor = BlendFactor::eZero,
-		.dstColorBlendFactor = BlendFactor::eOne,
-		.colorBlendOp = BlendOp::eAdd,
-		.srcAlphaBlendFactor = BlendFactor::eZero,
-		.dstAlphaBlendFactor = BlendFactor::eZero,
-		.alphaBlendOp = BlendOp::eAdd,
-		.colorWriteMask = flags
-	};
+	LOG_INFO("pipeline created: " << vertexShader << ", " << to_string(vertexFormat) << " vertices");
 
-	PipelineColorBlendStateCreateInfo cbs{
-		.logicOp = LogicOp::eClear,
-		.attachmentCount = 1,
-		.pAttachments = &colorBlendAttachment
+	return true;
+}
 
-	};
+void renderer::createHotReload() {
+	if (!hotReload || headless) {
+		return;
+	}
+	shaderReload.init(pipelines, {
+		{ "shader.vert", "shaders/vert.spv" },
+		{ "packed.vert", "shaders/packed.spv" },
+		{ "shader.frag", "shaders/frag.spv" } });
+}
 
-	PipelineLayoutCreateInfo pipeLayoutCi{};
+bool renderer::selectVertexShader() {
+	std::string path = "shaders/vert.spv";
+	shaderReflection reflection;
+	std::error_code ec;
+	if (std::filesystem::exists("shaders/packed.spv", ec) && shaders.load("shaders/packed.spv", &reflection)
+		&& vertexEncodingOf(reflection) == vertexEncoding::quantized) {
+		path = "shaders/packed.spv";
+	}
+	else {
+		if (std::filesystem::exists("shaders/packed.spv", ec)) {
+			LOG_WARN("shaders/packed.spv does not take positionDequant push constants (built without debug names?), "
+				"drawing full vertices with " << path);
+		}
+		reflection = {};
+		shaders.load(path, &reflection);
+	}
 
-	pipelineLayout = device->createPipelineLayout(pipeLayoutCi);
+	vertexEncoding encoding = vertexEncodingOf(reflection);
+	bool changed = path != vertexShader || encoding != vertexFormat;
+	vertexShader = path;
+	vertexFormat = encoding;
+	return changed;
+}
 
-	GraphicsPipelineCreateInfo pipelineCi{
-		.stageCount = 2,
-		.pStages = shaderStages,
-		.pVertexInputState = &vi,
-		.pInputAssemblyState = &ia,
-		.pViewportState = &viewport,
-		.pRasterizationState = &rs,
-		.pColorBlendState = &cbs,
-		.layout = pipelineLayout,
-		.renderPass = rp
-	};
+void renderer::reloadVertexShader() {
+	vertexEncoding uploaded = vertexFormat;
+	if (!selectVertexShader()) {
+		return;
+	}
 
-	Result result;
+	Device dev = *device;
+	if (vertexFormat != uploaded) {
+		vertexLayout layout = vertexLayout::make(vertexFormat);
+		for (Pipeline old : pipelines.retarget(layout.stride, layout.attributes)) {
+			deferDestroy([dev, old]() {
+				dev.destroyPipeline(old);
+			});
+		}
 
-	std::tie(result, pipeline) = device->createGraphicsPipeline(nullptr, pipelineCi);
+		// frames in flight still read the old buffers; the next submit waits for the new ones through
+		// the upload timeline
+		Buffer oldVb = vb, oldIb = ib;
+		allocation oldVbMem = vbMem, oldIbMem = ibMem;
+		deferDestroy([this, dev, oldVb, oldIb, oldVbMem, oldIbMem]() {
+			dev.destroyBuffer(oldVb);
+			allocator.free(oldVbMem);
+			dev.destroyBuffer(oldIb);
+			allocator.free(oldIbMem);
+		});
+		createVertexBuffer();
+		createIndexBuffer();
+		uploads.submit();
+	}
 
-	std::cout << "pipeline created" << std::endl;
+	defaultPipeline = pipelines.request({ .vertexShader = vertexShader, .fragmentShader = "shaders/frag.spv" });
+	pipeline = pipelines.wait(defaultPipeline);
+	pipelineLayout = pipelines.layout(defaultPipeline);
+	buildDrawList();
 
-	return true;
+	LOG_INFO("vertex shader switched: " << vertexShader << ", " << to_string(vertexFormat) << " vertices");
+}
 
+void renderer::swapReloadedPipelines() {
+	if (hotReload) {
+		// a rebuilt vertex shader may decode another vertex encoding than the one uploaded
+		std::vector<std::string> rebuilt = shaderReload.update();
+		if (std::find(rebuilt.begin(), rebuilt.end(), "shaders/vert.spv") != rebuilt.end()
+			|| std::find(rebuilt.begin(), rebuilt.end(), "shaders/packed.spv") != rebuilt.end()) {
+			reloadVertexShader();
+		}
+	}
 
+	// frames in flight may still be drawing with the pipelines a reload replaced
+	Device dev = *device;
+	for (Pipeline old : pipelines.swapReloaded()) {
+		deferDestroy([dev, old]() {
+			dev.destroyPipeline(old);
+		});
+	}
+	pipeline = pipelines.resolve(defaultPipeline, pipeline);
+	pipelineLayout = pipelines.layout(defaultPipeline);
 }
 
 bool renderer::createFramebuffers() {
@@ -548,60 +926,359 @@ bool renderer::createFramebuffers() {
 		framebuffers[i] = device->createFramebuffer(ci);
 	}
 
-	std::cout << "framebuffers created" << std::endl;
+	LOG_INFO("framebuffers created");
 
 	return true;
 }
 
 bool renderer::createCommandPool() {
-	CommandPoolCreateInfo ci{ .queueFamilyIndex = 0,
+	frames.resize(framesInFlight);
+
+	// transient: everything in the pool is re-recorded every frame and reset in one go
+	CommandPoolCreateInfo ci{ .flags = CommandPoolCreateFlagBits::eTransient,
+	.queueFamilyIndex = gfxFamily,
 	};
 
-	commandPool = device->createCommandPool(ci);
+	for (auto& frame : frames) {
+		frame.pool = device->createCommandPool(ci);
+		frame.workerPools.resize(workers.size());
+		for (auto& pool : frame.workerPools) {
+			pool = device->createCommandPool(ci);
+		}
+	}
 
-	std::cout << "command pool created" << std::endl;
+	LOG_INFO("command pools created");
 
 	return true;
 }
 
+void renderer::createProfiler() {
+	gpuProfile.init(*device, gpu, gfxFamily, framesInFlight);
+}
+
 bool renderer::createCommandBuffers() {
-	commandBuffers.resize(framebuffers.size());
+	for (auto& frame : frames) {
+		CommandBufferAllocateInfo ci{ .commandPool = frame.pool,
+		.level = CommandBufferLevel::ePrimary,
+		.commandBufferCount = 1 };
 
-	CommandBufferAllocateInfo ci{ .commandPool = commandPool,
-	.level = CommandBufferLevel::ePrimary,
-	.commandBufferCount = static_cast<uint32_t>(commandBuffers.size()) };
+		frame.cmd = device->allocateCommandBuffers(ci).front();
 
-	commandBuffers = device->allocateCommandBuffers(ci);
+		frame.secondaries.resize(frame.workerPools.size());
+		for (size_t i = 0; i < frame.workerPools.size(); i++) {
+			CommandBufferAllocateInfo secondaryCi{ .commandPool = frame.workerPools[i],
+			.level = CommandBufferLevel::eSecondary,
+			.commandBufferCount = 1 };
 
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		ClearValue clearColor = { std::array<float,4>{0.0f, 0.0f, 0.0f, 1.0f} };
+			frame.secondaries[i] = device->allocateCommandBuffers(secondaryCi).front();
+		}
+	}
 
-		CommandBufferBeginInfo info{};
+	LOG_INFO("command buffers allocated");
 
-		commandBuffers[i].begin(info);
+	return true;
+}
 
-		RenderPassBeginInfo rpInfo{
-			.renderPass = rp,
-			.framebuffer = framebuffers[i],
-			.renderArea = {.offset = {0, 0}, .extent = extent},
-			.clearValueCount = 1,
-			.pClearValues = &clearColor };
+void renderer::recordCommandBuffer(frameContext& frame, uint32_t imgIndex) {
+	CommandBuffer cmd = frame.cmd;
+	ClearValue clearColor = { std::array<float,4>{0.0f, 0.0f, 0.0f, 1.0f} };
+
+	CommandBufferBeginInfo info{ .flags = CommandBufferUsageFlagBits::eOneTimeSubmit };
+
+	cmd.begin(info);
+
+	// reads back the timestamps this frame context recorded framesInFlight frames ago
+	gpuProfile.beginFrame(cmd, static_cast<uint32_t>(&frame - frames.data()));
+	uint32_t frameRegion = gpuProfile.begin(cmd, "frame");
+
+	RenderPassBeginInfo rpInfo{
+		.renderPass = rp,
+		.framebuffer = framebuffers[imgIndex],
+		.renderArea = {.offset = {0, 0}, .extent = extent},
+		.clearValueCount = 1,
+		.pClearValues = &clearColor };
+
+	pipelines.resolveDraws(scene.draws, useFallbackPipeline ? pipeline : Pipeline(), pipelineLayout);
+
+	uint32_t slots = recordSlots(frame);
+
+	if (meshletCull.ready()) {
+		gpuScope cullScope(gpuProfile, cmd, "meshlet cull");
+		meshletCull.record(cmd, static_cast<uint32_t>(&frame - frames.data()));
+	}
+
+	uint32_t passRegion = gpuProfile.begin(cmd, "render pass");
+
+	if (slots <= 1) {
+		cmd.beginRenderPass(rpInfo, SubpassContents::eInline);
+		setViewportScissor(cmd);
+		{
+			gpuScope drawScope(gpuProfile, cmd, "draws");
+			scene.record(cmd);
+		}
+		cmd.endRenderPass();
+	}
+	else {
+		cmd.beginRenderPass(rpInfo, SubpassContents::eSecondaryCommandBuffers);
+
+		CommandBufferInheritanceInfo inheritance{ .renderPass = rp,
+		.subpass = 0,
+		.framebuffer = framebuffers[imgIndex] };
+
+		// contiguous ranges keep submission order identical to the single-threaded path
+		size_t drawCount = scene.draws.size();
+		workers.parallelFor(slots, [&](size_t slot) {
+			CommandBuffer secondary = frame.secondaries[slot];
+			size_t first = drawCount * slot / slots;
+			size_t last = drawCount * (slot + 1) / slots;
+
+			CommandBufferBeginInfo secondaryInfo{ .flags = CommandBufferUsageFlagBits::eOneTimeSubmit
+				| CommandBufferUsageFlagBits::eRenderPassContinue,
+			.pInheritanceInfo = &inheritance };
+
+			CPU_ZONE("record draws");
+			secondary.begin(secondaryInfo);
+			{
+				gpuScope drawScope(gpuProfile, secondary, "draw group");
+				// dynamic state is not inherited from the primary
+				setViewportScissor(secondary);
+				scene.recordDraws(secondary, first, last - first);
+				if (slot == slots - 1) {
+					scene.recordCustom(secondary);
+				}
+			}
+			secondary.end();
+		});
+
+		cmd.executeCommands(slots, frame.secondaries.data());
+
+		cmd.endRenderPass();
+	}
+
+	gpuProfile.end(cmd, passRegion);
+
+	if (headless && captureFrames) {
+		gpuScope readbackScope(gpuProfile, cmd, "readback");
+		recordReadback(cmd, imgIndex);
+	}
+
+	gpuProfile.end(cmd, frameRegion);
+	cmd.end();
+}
+
+void renderer::setViewportScissor(CommandBuffer cmd) {
+	Viewport vp{};
+	vp.x = 		 0.0f;
+	vp.width = (float)extent.width;
+	vp.height = -(float)extent.height;
+	vp.y = extent.height;
+	vp.minDepth = 0.0f;
+	vp.maxDepth = 1.0f;
+
+	Rect2D scissor{};
+
+	scissor.extent = extent;
+
+	cmd.setViewport(0, vp);
+	cmd.setScissor(0, scissor);
+}
+
+uint32_t renderer::recordSlots(const frameContext& frame) const {
+	size_t slots = std::min<size_t>(recordThreads, frame.secondaries.size());
+	slots = std::min<size_t>(slots, scene.draws.size() / std::max(minDrawsPerThread, 1u));
+	return static_cast<uint32_t>(std::max<size_t>(slots, 1));
+}
+
+void renderer::buildDrawList() {
+	scene.clear();
+
+	// one draw per submesh so materials can diverge later without touching the recording path
+	bool quantized = vertexFormat == vertexEncoding::quantized;
+	for (uint32_t i = 0; i < geometry.submeshCount; i++) {
+		const submesh& part = geometry.submeshes[i];
+		scene.add({ .pipeline = pipeline,
+		.pipelineId = defaultPipeline,
+		.vertexBuffer = vb,
+		.indexBuffer = ib,
+		.indexType = indexType,
+		.indexCount = part.indexCount,
+		.firstIndex = part.firstIndex,
+		.vertexOffset = quantized ? packedGeometry.vertexOffsets[i] : 0,
+		.layout = pipelineLayout,
+		.pushConstants = quantized ? &packedGeometry.dequant[i] : nullptr,
+		.pushConstantSize = quantized ? static_cast<uint32_t>(sizeof(positionDequant)) : 0 });
+	}
+
+	// submesh spheres go in as their bounding cubes
+	submeshBounds.clear();
+	for (uint32_t i = 0; i < geometry.submeshCount; i++) {
+		const submesh& part = geometry.submeshes[i];
+		submeshBounds.add(part.center, glm::vec3(part.radius));
+	}
+}
 
-		commandBuffers[i].beginRenderPass(rpInfo, SubpassContents::eInline);
+void renderer::selectGeometry(frameContext& frame) {
+	CPU_ZONE("select geometry");
+	visibleMeshlets = 0;
+	drawnTriangles = 0;
+	meshletCullView view = meshletCullView::fromOrthographic(viewProj, viewForward);
+	lodLevels.resize(geometry.submeshCount, 0);
+
+	// the compute pass copies each state into the commands of its submesh's meshlets; submeshes left
+	// zeroed get empty commands. out of transient space, this frame culls on the CPU
+	uint32_t slot = static_cast<uint32_t>(&frame - frames.data());
+	meshletCullSubmesh* gpuSubmeshes = nullptr;
+	if (meshletCulling && meshletCull.ready()) {
+		gpuSubmeshes = meshletCull.begin(slot, frame.transient, meshletBuffer, view, geometry.submeshCount,
+			geometry.meshletCount);
+	}
+
+	// whole submeshes first; only those in view get a LOD and meshlets
+	uint32_t visibleCount = cullFrustum(submeshBounds, view.planes, visibleSubmeshes);
+
+	// the model's draws come first, one per submesh, as buildDrawList lays them out
+	size_t count = std::min<size_t>(geometry.submeshCount, scene.draws.size());
+	uint32_t nextVisible = 0;
+	for (size_t i = 0; i < count; i++) {
+		drawItem& item = scene.draws[i];
+		const submesh& part = geometry.submeshes[i];
+		item.indirectBuffer = nullptr;
+
+		if (nextVisible == visibleCount || visibleSubmeshes[nextVisible] != i) {
+			// an indirect draw of no commands is skipped
+			item.indirectBuffer = frame.transient.buffer;
+			item.indirectCount = 0;
+			continue;
+		}
+		nextVisible++;
+
+		uint32_t& level = lodLevels[i];
+		if (lodPixelError <= 0.0f || part.lodCount <= 1) {
+			level = 0;
+		}
+		else {
+			float pixelsPerUnit = lodPixelsPerUnit(viewProj, float(extent.height), part, nullptr);
+			level = selectLod(geometry.lods + part.firstLod, part.lodCount, level, pixelsPerUnit, lodPixelError, lodHysteresis);
+		}
+		bool culled = meshletCulling && level == 0 && part.meshletCount > 0;
+		if (level == 0 && !culled) {
+			drawnTriangles += part.indexCount / 3;
+			continue;
+		}
+		if (culled && gpuSubmeshes) {
+			gpuSubmeshes[i] = { .vertexOffset = item.vertexOffset,
+			.instanceCount = item.instanceCount,
+			.firstInstance = item.firstInstance };
+			item.indirectBuffer = frame.transient.buffer;
+			item.indirectOffset = meshletCull.commandOffset(slot, part.firstMeshlet);
+			item.indirectCount = part.meshletCount;
+			continue;
+		}
+
+		// a frame out of transient space draws the submesh whole
+		DeviceSize offset;
+		void* data;
+		uint32_t capacity = culled ? part.meshletCount : 1;
+		if (!frame.transient.allocate(capacity * sizeof(DrawIndexedIndirectCommand), sizeof(uint32_t), offset, data)) {
+			drawnTriangles += part.indexCount / 3;
+			continue;
+		}
+
+		auto* commands = static_cast<DrawIndexedIndirectCommand*>(data);
+		uint32_t written = 0;
+		if (!culled) {
+			// coarser levels are drawn whole; their meshlets would not be worth the culling
+			const meshLod& lod = geometry.lods[part.firstLod + level];
+			commands[written++] = { .indexCount = lod.indexCount,
+			.instanceCount = item.instanceCount,
+			.firstIndex = lod.firstIndex,
+			.vertexOffset = item.vertexOffset,
+			.firstInstance = item.firstInstance };
+			drawnTriangles += lod.indexCount / 3;
+		}
+		else {
+			// a submesh's meshlets are consecutive index ranges, so each run of visible ones is one command
+			bool extend = false;
+			for (uint32_t m = 0; m < part.meshletCount; m++) {
+				const meshlet& ml = geometry.meshlets[part.firstMeshlet + m];
+				if (!meshletVisible(ml, view)) {
+					extend = false;
+					continue;
+				}
+				visibleMeshlets++;
+				drawnTriangles += ml.indexCount / 3;
+				if (extend) {
+					commands[written - 1].indexCount += ml.indexCount;
+					continue;
+				}
+				commands[written++] = { .indexCount = ml.indexCount,
+				.instanceCount = item.instanceCount,
+				.firstIndex = ml.firstIndex,
+				.vertexOffset = item.vertexOffset,
+				.firstInstance = item.firstInstance };
+				extend = true;
+			}
+		}
+
+		item.indirectBuffer = frame.transient.buffer;
+		item.indirectOffset = offset;
+		item.indirectCount = written;
+	}
+}
+
+void renderer::benchmarkRecording(uint32_t drawCount, uint32_t iterations) {
+	device->waitIdle();
+
+	drawList saved = scene;
+	uint32_t savedThreads = recordThreads;
+
+	// repeat the model's draws until the list looks like a full scene
+	scene.draws.clear();
+	for (uint32_t i = 0; i < drawCount && !saved.draws.empty(); i++) {
+		scene.add(saved.draws[i % saved.draws.size()]);
+	}
+
+	frameContext& frame = frames[frameIndex];
+
+	for (uint32_t threads : { 1u, 2u, 4u, 8u }) {
+		recordThreads = threads;
+		uint32_t slots = recordSlots(frame);
+
+		auto start = framePacer::clock::now();
+		for (uint32_t i = 0; i < iterations; i++) {
+			device->resetCommandPool(frame.pool);
+			for (auto& pool : frame.workerPools) {
+				device->resetCommandPool(pool);
+			}
+			recordCommandBuffer(frame, 0);
+		}
+		std::chrono::duration<double, std::micro> elapsed = framePacer::clock::now() - start;
+
+		LOG_INFO("record " << scene.draws.size() << " draws, " << threads << " threads (" << slots << " used): "
+			<< elapsed.count() / iterations << " us");
+	}
+
+	device->resetCommandPool(frame.pool);
+	for (auto& pool : frame.workerPools) {
+		device->resetCommandPool(pool);
+	}
+
+	scene = std::move(saved);
+	recordThreads = savedThreads;
+}
 
-		commandBuffers[i].bindPipeline(PipelineBindPoint::eGraphics, pipeline);
-		
-		Buffer vbs[] = { vb };
-		DeviceSize offsets[] = { 0 };
-		
-		commandBuffers[i].bindVertexBuffers(0, 1, vbs, offsets);
-		commandBuffers[i].draw(static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+bool renderer::createTransientBuffers() {
+	const DeviceSize transientSize = 4 * 1024 * 1024;
 
-		commandBuffers[i].endRenderPass();
-		commandBuffers[i].end();
+	for (auto& frame : frames) {
+		createBuffer(transientSize, BufferUsageFlagBits::eUniformBuffer | BufferUsageFlagBits::eStorageBuffer
+			| BufferUsageFlagBits::eVertexBuffer | BufferUsageFlagBits::eIndexBuffer | BufferUsageFlagBits::eIndirectBuffer
+			| BufferUsageFlagBits::eTransferSrc,
+			MemoryPropertyFlagBits::eHostVisible | MemoryPropertyFlagBits::eHostCoherent,
+			frame.transient.buffer, frame.transient.memory);
 	}
 
-	std::cout << "command buffers allocated" << std::endl;
+	LOG_INFO("transient buffers created");
 
 	return true;
 }
@@ -610,61 +1287,179 @@ bool renderer::createSemaphores() {
 
 	SemaphoreCreateInfo ci{};
 
-	imgSemaphore = device->createSemaphore(ci);
-	renderSemaphore = device->createSemaphore(ci);
+	for (auto& frame : frames) {
+		frame.acquired = device->createSemaphore(ci);
+	}
+
+	createRenderSemaphores();
+
+	LOG_INFO("semaphores created");
+
+	return true;
+}
+
+bool renderer::createRenderSemaphores() {
+
+	SemaphoreCreateInfo ci{};
 
-	std::cout << "semaphores created" << std::endl;
+	// present waits on these, so they belong to the image rather than the frame
+	renderSemaphores.resize(images.size());
+	for (auto& semaphore : renderSemaphores) {
+		semaphore = device->createSemaphore(ci);
+	}
 
 	return true;
 }
 
-bool renderer::createFence() {
+bool renderer::createTimeline() {
 
-	FenceCreateInfo ci{ .flags = FenceCreateFlagBits::eSignaled };
-	fence = device->createFence(ci);
+	SemaphoreTypeCreateInfo typeCi{ .semaphoreType = SemaphoreType::eTimeline, .initialValue = 0 };
+	SemaphoreCreateInfo ci{ .pNext = &typeCi };
+	frameTimeline = device->createSemaphore(ci);
 
-	std::cout << "fence created" << std::endl;
+	LOG_INFO("frame timeline created");
 
 	return true;
 }
 
+uint64_t renderer::completedFrame() {
+	return device->getSemaphoreCounterValue(frameTimeline);
+}
+
+bool renderer::frameComplete(uint64_t frame) {
+	return completedFrame() >= frame;
+}
+
+void renderer::deferDestroy(std::function<void()> destroy) {
+	// the frame being recorded right now is frameCounter + 1
+	garbage.push_back({ frameCounter + 1, std::move(destroy) });
+}
+
+void renderer::collectGarbage() {
+	uint64_t completed = completedFrame();
+	while (!garbage.empty() && garbage.front().frame <= completed) {
+		garbage.front().destroy();
+		garbage.pop_front();
+	}
+}
+
 void renderer::render() {
+	CPU_FRAME();
+	frameContext& frame = frames[frameIndex];
+
+	// only blocks when the GPU is framesInFlight frames behind
+	auto waitStart = framePacer::clock::now();
+	{
+		CPU_ZONE("gpu wait");
+		SemaphoreWaitInfo waitInfo{ .semaphoreCount = 1, .pSemaphores = &frameTimeline, .pValues = &frame.submitted };
+		device->waitSemaphores(waitInfo, UINT64_MAX);
+	}
+	pacer.record(paceStage::gpuWait, framePacer::clock::now() - waitStart);
+
+	{
+		CPU_ZONE("garbage");
+		collectGarbage();
+		swapReloadedPipelines();
+	}
+
+	// headless frames own their offscreen image outright
+	uint32_t imgIndex = frameIndex;
+
+	if (!headless) {
+		CPU_ZONE("acquire");
+		auto acquireStart = framePacer::clock::now();
+		try {
+			imgIndex = device->acquireNextImageKHR(swapchain, UINT64_MAX, frame.acquired, nullptr).value;
+			pacer.record(paceStage::acquire, framePacer::clock::now() - acquireStart);
+		}
+		catch (const OutOfDateKHRError&) {
+			recreateSwapchain();
+			return;
+		}
+	}
 
-	device->waitForFences(fence, VK_TRUE, UINT64_MAX);
+	device->resetCommandPool(frame.pool);
+	for (auto& pool : frame.workerPools) {
+		device->resetCommandPool(pool);
+	}
+	frame.transient.reset();
+	selectGeometry(frame);
 
-	device->resetFences(fence);
+	auto recordStart = framePacer::clock::now();
+	{
+		CPU_ZONE("record");
+		recordCommandBuffer(frame, imgIndex);
+	}
+	pacer.record(paceStage::record, framePacer::clock::now() - recordStart);
 
-	uint32_t imgIndex;
+	frame.submitted = ++frameCounter;
 
-	imgIndex = device->acquireNextImageKHR(swapchain, UINT64_MAX, imgSemaphore, nullptr).value;
+	// binary semaphores ignore their value slot; the upload timeline guards geometry still in transfer
+	Semaphore waitSemaphores[] = { frame.acquired, uploads.timeline() };
+	uint64_t waitValues[] = { 0, uploads.lastSubmitted() };
+	Semaphore signalSemaphores[] = { renderSemaphores[imgIndex], frameTimeline };
+	uint64_t signalValues[] = { 0, frame.submitted };
 
-	Semaphore waitSemaphores[] = { imgSemaphore };
-	Semaphore signalSemaphores[] = { renderSemaphore };
+	// the meshlet cull pass reads uploaded meshlets before any vertex is fetched
+	PipelineStageFlags waitDstStages[] = { PipelineStageFlagBits::eColorAttachmentOutput,
+		PipelineStageFlagBits::eVertexInput | PipelineStageFlagBits::eComputeShader };
 
-	PipelineStageFlags waitDstStages[] = { PipelineStageFlagBits::eColorAttachmentOutput };
+	// headless has no acquire to wait for and nothing to present, so it drops the binary semaphores
+	uint32_t first = headless ? 1 : 0;
 
 	SwapchainKHR swapchains[] = { swapchain };
 
-	SubmitInfo info{ .waitSemaphoreCount = 1,
-	.pWaitSemaphores = waitSemaphores,
-	.pWaitDstStageMask = waitDstStages,
+	TimelineSemaphoreSubmitInfo timelineInfo{ .waitSemaphoreValueCount = 2 - first,
+	.pWaitSemaphoreValues = waitValues + first,
+	.signalSemaphoreValueCount = 2 - first,
+	.pSignalSemaphoreValues = signalValues + first };
+
+	SubmitInfo info{ .pNext = &timelineInfo,
+	.waitSemaphoreCount = 2 - first,
+	.pWaitSemaphores = waitSemaphores + first,
+	.pWaitDstStageMask = waitDstStages + first,
 	.commandBufferCount = 1,
-	.pCommandBuffers = &commandBuffers[imgIndex],
-	.signalSemaphoreCount = 1,
-	.pSignalSemaphores = signalSemaphores };
+	.pCommandBuffers = &frame.cmd,
+	.signalSemaphoreCount = 2 - first,
+	.pSignalSemaphores = signalSemaphores + first };
 
-	gfxQueue.submit(info);
+	{
+		CPU_ZONE("submit");
+		gfxQueue.submit(info);
+	}
+	gpuProfile.submitted(frameIndex);
+	pacer.submitted();
+
+	if (headless) {
+		pacer.presented();
+		lastFrameIndex = frameIndex;
+		frameIndex = (frameIndex + 1) % framesInFlight;
+		return;
+	}
 
 	PresentInfoKHR presentInfo{ .waitSemaphoreCount = 1,
-	.pWaitSemaphores = signalSemaphores,
+	.pWaitSemaphores = &renderSemaphores[imgIndex],
 	.swapchainCount = 1,
 	.pSwapchains = swapchains,
 	.pImageIndices = &imgIndex };
 
-	presentQueue.presentKHR(presentInfo);
-
+	Result presentResult;
+	auto presentStart = framePacer::clock::now();
+	try {
+		CPU_ZONE("present");
+		presentResult = presentQueue.presentKHR(presentInfo);
+	}
+	catch (const OutOfDateKHRError&) {
+		presentResult = Result::eErrorOutOfDateKHR;
+	}
+	pacer.record(paceStage::present, framePacer::clock::now() - presentStart);
+	pacer.presented();
 
+	frameIndex = (frameIndex + 1) % framesInFlight;
 
+	if (presentResult == Result::eSuboptimalKHR || presentResult == Result::eErrorOutOfDateKHR || framebufferResized) {
+		recreateSwapchain();
+	}
 }
 
 
@@ -0,0 +1,108 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "shaders.h"
+#include "log.h"
+#include <cstring>
+#include "util.h"
+
+using namespace vk;
+
+bool validateSpirv(const void* code, size_t size) {
+	// header is five words; the driver wants whole, 4-byte aligned words in host order
+	if (size < 5 * sizeof(uint32_t) || size % sizeof(uint32_t) != 0
+		|| reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0) {
+		return false;
+	}
+	return *static_cast<const uint32_t*>(code) == spirvMagic;
+}
+
+void shaderRegistry::init(Device dev, bool moduleIdentifiers) {
+	device = dev;
+	identifiers = moduleIdentifiers;
+}
+
+void shaderRegistry::destroy() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& [hash, item] : modules) {
+		device.destroyShaderModule(item.module);
+	}
+	modules.clear();
+	paths.clear();
+}
+
+ShaderModule shaderRegistry::load(const std::string& path, shaderReflection* reflection) {
+	mappedFile file;
+	if (!file.open(path) || !validateSpirv(file.data, file.size)) {
+		LOG_WARN("invalid SPIR-V: " << path);
+		return nullptr;
+	}
+
+	uint64_t hash = hashBytes(file.data, file.size);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	paths[path] = hash;
+
+	auto found = modules.find(hash);
+	if (found != modules.end()) {
+		if (reflection) {
+			*reflection = found->second.reflection;
+		}
+		return found->second.module;
+	}
+
+	entry item;
+	if (!reflectSpirv(reinterpret_cast<const uint32_t*>(file.data), file.size / sizeof(uint32_t), item.reflection)) {
+		LOG_WARN("SPIR-V reflection failed: " << path);
+		return nullptr;
+	}
+
+	ShaderModuleCreateInfo ci{ .codeSize = file.size,
+	.pCode = reinterpret_cast<const uint32_t*>(file.data) };
+
+	item.module = device.createShaderModule(ci);
+
+#ifdef VK_EXT_shader_module_identifier
+	if (identifiers) {
+		// not exported by the loader, so fetched per device
+		auto getIdentifier = reinterpret_cast<PFN_vkGetShaderModuleIdentifierEXT>(
+			device.getProcAddr("vkGetShaderModuleIdentifierEXT"));
+		if (getIdentifier) {
+			VkShaderModuleIdentifierEXT id{ VK_STRUCTURE_TYPE_SHADER_MODULE_IDENTIFIER_EXT };
+			getIdentifier(device, item.module, &id);
+			item.identifier.assign(id.identifier, id.identifier + id.identifierSize);
+		}
+	}
+#endif
+
+	modules.emplace(hash, item);
+	if (reflection) {
+		*reflection = item.reflection;
+	}
+
+	LOG_INFO("shader module created: " << path);
+
+	return item.module;
+}
+
+ShaderModule shaderRegistry::find(uint64_t hash) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = modules.find(hash);
+	return found != modules.end() ? found->second.module : ShaderModule();
+}
+
+uint64_t shaderRegistry::hashOf(const std::string& path) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = paths.find(path);
+	return found != paths.end() ? found->second : 0;
+}
+
+std::vector<uint8_t> shaderRegistry::identifier(uint64_t hash) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = modules.find(hash);
+	return found != modules.end() ? found->second.identifier : std::vector<uint8_t>();
+}
+
+size_t shaderRegistry::moduleCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return modules.size();
+}
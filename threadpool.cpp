@@ -0,0 +1,53 @@
+#include "threadpool.h"
+
+threadPool::threadPool(unsigned threadCount) {
+	if (threadCount == 0) {
+		threadCount = 1;
+	}
+	workers.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; i++) {
+		workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+threadPool::~threadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void threadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+	std::vector<std::future<void>> pending;
+	pending.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		pending.push_back(submit([&fn, i]() { fn(i); }));
+	}
+	// get() rethrows the first job exception after every job has finished
+	for (auto& job : pending) {
+		job.wait();
+	}
+	for (auto& job : pending) {
+		job.get();
+	}
+}
+
+void threadPool::workerLoop() {
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty()) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
@@ -0,0 +1,195 @@
+#include "tlsf.h"
+#include <bit>
+
+void tlsf::init(uint64_t size) {
+	nodes.clear();
+	spareNodes.clear();
+	flBitmap = 0;
+	for (uint32_t fl = 0; fl < flCount; fl++) {
+		slBitmap[fl] = 0;
+		for (uint32_t sl = 0; sl < slCount; sl++) {
+			heads[fl][sl] = invalid;
+		}
+	}
+
+	total = size;
+	usedBytes = 0;
+	liveCount = 0;
+
+	uint32_t n = newNode();
+	nodes[n] = { 0, size, invalid, invalid, invalid, invalid, true };
+	insertFree(n);
+}
+
+void tlsf::mapping(uint64_t size, uint32_t& fl, uint32_t& sl) {
+	if (size < slCount) {
+		fl = 0;
+		sl = static_cast<uint32_t>(size);
+		return;
+	}
+	uint32_t msb = 63 - static_cast<uint32_t>(std::countl_zero(size));
+	fl = msb - slBits + 1;
+	sl = static_cast<uint32_t>(size >> (msb - slBits)) ^ slCount;
+}
+
+uint32_t tlsf::newNode() {
+	if (!spareNodes.empty()) {
+		uint32_t n = spareNodes.back();
+		spareNodes.pop_back();
+		return n;
+	}
+	nodes.push_back({});
+	return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void tlsf::insertFree(uint32_t n) {
+	uint32_t fl, sl;
+	mapping(nodes[n].size, fl, sl);
+
+	nodes[n].free = true;
+	nodes[n].prevFree = invalid;
+	nodes[n].nextFree = heads[fl][sl];
+	if (heads[fl][sl] != invalid) {
+		nodes[heads[fl][sl]].prevFree = n;
+	}
+	heads[fl][sl] = n;
+
+	flBitmap |= 1ull << fl;
+	slBitmap[fl] |= 1u << sl;
+}
+
+void tlsf::removeFree(uint32_t n) {
+	uint32_t fl, sl;
+	mapping(nodes[n].size, fl, sl);
+
+	node& nd = nodes[n];
+	if (nd.prevFree != invalid) {
+		nodes[nd.prevFree].nextFree = nd.nextFree;
+	}
+	else {
+		heads[fl][sl] = nd.nextFree;
+	}
+	if (nd.nextFree != invalid) {
+		nodes[nd.nextFree].prevFree = nd.prevFree;
+	}
+	nd.free = false;
+
+	if (heads[fl][sl] == invalid) {
+		slBitmap[fl] &= ~(1u << sl);
+		if (slBitmap[fl] == 0) {
+			flBitmap &= ~(1ull << fl);
+		}
+	}
+}
+
+uint32_t tlsf::findFree(uint64_t size) {
+	// round up to the next bin so any block found there is large enough
+	if (size >= slCount) {
+		uint32_t msb = 63 - static_cast<uint32_t>(std::countl_zero(size));
+		uint64_t round = (1ull << (msb - slBits)) - 1;
+		if (size > UINT64_MAX - round) {
+			return invalid;
+		}
+		size += round;
+	}
+
+	uint32_t fl, sl;
+	mapping(size, fl, sl);
+	if (fl >= flCount) {
+		return invalid;
+	}
+
+	uint32_t slMap = slBitmap[fl] & (~0u << sl);
+	if (slMap == 0) {
+		uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0) {
+			return invalid;
+		}
+		fl = static_cast<uint32_t>(std::countr_zero(flMap));
+		slMap = slBitmap[fl];
+	}
+	sl = static_cast<uint32_t>(std::countr_zero(slMap));
+	return heads[fl][sl];
+}
+
+// cuts n down to size bytes and returns the new free tail node, or invalid when nothing is left over
+uint32_t tlsf::split(uint32_t n, uint64_t size) {
+	if (nodes[n].size == size) {
+		return invalid;
+	}
+
+	uint32_t rest = newNode();
+	node& nd = nodes[n];
+	nodes[rest] = { nd.offset + size, nd.size - size, n, nd.nextPhys, invalid, invalid, false };
+	if (nd.nextPhys != invalid) {
+		nodes[nd.nextPhys].prevPhys = rest;
+	}
+	nd.nextPhys = rest;
+	nd.size = size;
+	return rest;
+}
+
+uint32_t tlsf::allocate(uint64_t size, uint64_t alignment, uint64_t& offset) {
+	if (size == 0) {
+		size = 1;
+	}
+	if (alignment == 0) {
+		alignment = 1;
+	}
+
+	uint32_t n = findFree(size + alignment - 1);
+	if (n == invalid) {
+		return invalid;
+	}
+	removeFree(n);
+
+	uint64_t aligned = (nodes[n].offset + alignment - 1) / alignment * alignment;
+	uint64_t padding = aligned - nodes[n].offset;
+	if (padding > 0) {
+		// leading padding stays behind as its own free range
+		uint32_t body = split(n, padding);
+		insertFree(n);
+		n = body;
+	}
+
+	uint32_t rest = split(n, size);
+	if (rest != invalid) {
+		insertFree(rest);
+	}
+
+	nodes[n].free = false;
+	offset = nodes[n].offset;
+	usedBytes += nodes[n].size;
+	liveCount++;
+	return n;
+}
+
+void tlsf::free(uint32_t n) {
+	usedBytes -= nodes[n].size;
+	liveCount--;
+
+	uint32_t prev = nodes[n].prevPhys;
+	if (prev != invalid && nodes[prev].free) {
+		removeFree(prev);
+		nodes[prev].size += nodes[n].size;
+		nodes[prev].nextPhys = nodes[n].nextPhys;
+		if (nodes[n].nextPhys != invalid) {
+			nodes[nodes[n].nextPhys].prevPhys = prev;
+		}
+		spareNodes.push_back(n);
+		n = prev;
+	}
+
+	uint32_t next = nodes[n].nextPhys;
+	if (next != invalid && nodes[next].free) {
+		removeFree(next);
+		nodes[n].size += nodes[next].size;
+		nodes[n].nextPhys = nodes[next].nextPhys;
+		if (nodes[next].nextPhys != invalid) {
+			nodes[nodes[next].nextPhys].prevPhys = n;
+		}
+		spareNodes.push_back(next);
+	}
+
+	insertFree(n);
+}
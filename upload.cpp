@@ -0,0 +1,182 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstring>
+#include "upload.h"
+#include "log.h"
+
+using namespace vk;
+
+void uploadRing::init(Device dev, gpuAllocator& memAllocator, Queue transferQueue, uint32_t queueFamily,
+	DeviceSize ringCapacity) {
+	device = dev;
+	allocator = &memAllocator;
+	queue = transferQueue;
+	capacity = ringCapacity;
+
+	CommandPoolCreateInfo poolCi{ .flags = CommandPoolCreateFlagBits::eResetCommandBuffer,
+		.queueFamilyIndex = queueFamily };
+	pool = device.createCommandPool(poolCi);
+
+	CommandBufferAllocateInfo allocCi{ .commandPool = pool,
+		.level = CommandBufferLevel::ePrimary,
+		.commandBufferCount = batchCount };
+	auto cmds = device.allocateCommandBuffers(allocCi);
+
+	for (uint32_t i = 0; i < batchCount; i++) {
+		batches[i].cmd = cmds[i];
+	}
+
+	SemaphoreTypeCreateInfo typeCi{ .semaphoreType = SemaphoreType::eTimeline, .initialValue = 0 };
+	timelineSemaphore = device.createSemaphore(SemaphoreCreateInfo{ .pNext = &typeCi });
+
+	BufferCreateInfo bufferInfo{
+		.size = capacity,
+		.usage = BufferUsageFlagBits::eTransferSrc,
+		.sharingMode = SharingMode::eExclusive
+	};
+	staging = device.createBuffer(bufferInfo);
+
+	MemoryRequirements memReq = device.getBufferMemoryRequirements(staging);
+
+	if (!allocator->allocate(memReq, MemoryPropertyFlagBits::eHostVisible | MemoryPropertyFlagBits::eHostCoherent,
+		resourceKind::linear, false, stagingMem)) {
+		throw OutOfHostMemoryError("no host-visible memory for the staging ring");
+	}
+	device.bindBufferMemory(staging, stagingMem.memory, stagingMem.offset);
+
+	mapped = static_cast<uint8_t*>(stagingMem.mapped);
+
+	LOG_INFO("upload ring created: " << capacity / (1024 * 1024) << " MB on queue family " << queueFamily);
+}
+
+void uploadRing::destroy() {
+	if (recording) {
+		submit();
+	}
+	wait(lastSubmitted());
+
+	device.destroySemaphore(timelineSemaphore);
+	device.destroyCommandPool(pool);
+
+	device.destroyBuffer(staging);
+	allocator->free(stagingMem);
+	mapped = nullptr;
+}
+
+void uploadRing::uploadBuffer(Buffer dst, DeviceSize dstOffset, const void* data, DeviceSize size) {
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+
+	// anything larger than the ring goes through in ring-sized pieces
+	while (size > 0) {
+		DeviceSize piece = std::min(size, capacity);
+		DeviceSize offset = reserve(piece);
+
+		batch& b = batches[current];
+		if (!recording) {
+			if (b.inFlight) {
+				retire(b);
+			}
+			b.cmd.begin(CommandBufferBeginInfo{ .flags = CommandBufferUsageFlagBits::eOneTimeSubmit });
+			recording = true;
+		}
+
+		memcpy(mapped + offset, src, static_cast<size_t>(piece));
+
+		BufferCopy region{ .srcOffset = offset, .dstOffset = dstOffset, .size = piece };
+		b.cmd.copyBuffer(staging, dst, region);
+
+		src += piece;
+		dstOffset += piece;
+		size -= piece;
+	}
+}
+
+uint64_t uploadRing::submit() {
+	if (!recording) {
+		return 0;
+	}
+
+	batch& b = batches[current];
+	b.cmd.end();
+	b.id = nextBatchId++;
+	b.ringHead = head;
+
+	TimelineSemaphoreSubmitInfo timelineInfo{ .signalSemaphoreValueCount = 1, .pSignalSemaphoreValues = &b.id };
+	SubmitInfo info{ .pNext = &timelineInfo,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &b.cmd,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &timelineSemaphore };
+	queue.submit(info);
+
+	b.inFlight = true;
+	recording = false;
+	current = (current + 1) % batchCount;
+
+	return b.id;
+}
+
+bool uploadRing::complete(uint64_t batchId) {
+	uint64_t reached = device.getSemaphoreCounterValue(timelineSemaphore);
+	while (batch* b = oldestInFlight()) {
+		if (b->id > reached) {
+			break;
+		}
+		retire(*b);
+	}
+	return completedId >= batchId;
+}
+
+void uploadRing::wait(uint64_t batchId) {
+	while (completedId < batchId) {
+		batch* b = oldestInFlight();
+		if (!b) {
+			break;
+		}
+		retire(*b);
+	}
+}
+
+DeviceSize uploadRing::reserve(DeviceSize size) {
+	uint64_t offset = (head + copyAlignment - 1) & ~uint64_t(copyAlignment - 1);
+	if (offset % capacity + size > capacity) {
+		// never split a copy across the end of the ring
+		offset += capacity - offset % capacity;
+	}
+
+	while (offset + size - tail > capacity) {
+		if (batch* b = oldestInFlight()) {
+			retire(*b);
+		}
+		else if (recording) {
+			submit();
+		}
+		else {
+			// nothing is live, the whole ring is free
+			tail = offset;
+		}
+	}
+
+	head = offset + size;
+	return offset % capacity;
+}
+
+void uploadRing::retire(batch& b) {
+	SemaphoreWaitInfo waitInfo{ .semaphoreCount = 1, .pSemaphores = &timelineSemaphore, .pValues = &b.id };
+	device.waitSemaphores(waitInfo, UINT64_MAX);
+	b.inFlight = false;
+	tail = b.ringHead;
+	completedId = b.id;
+}
+
+uploadRing::batch* uploadRing::oldestInFlight() {
+	batch* oldest = nullptr;
+	for (auto& b : batches) {
+		if (b.inFlight && (!oldest || b.id < oldest->id)) {
+			oldest = &b;
+		}
+	}
+	return oldest;
+}
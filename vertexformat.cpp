@@ -0,0 +1,197 @@
+#define VULKAN_HPP_NO_CONSTRUCTORS
+
+#include "vertexformat.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace vk;
+
+vertexLayout vertexLayout::make(vertexEncoding encoding) {
+	if (encoding == vertexEncoding::full) {
+		return { encoding, sizeof(Vertex), {
+			{ 0, offsetof(Vertex, pos), Format::eR32G32B32Sfloat },
+			{ 1, offsetof(Vertex, normal), Format::eR32G32B32Sfloat },
+			{ 2, offsetof(Vertex, texCoord), Format::eR32G32Sfloat } } };
+	}
+	return { encoding, sizeof(packedVertex), {
+		{ 0, offsetof(packedVertex, pos), Format::eR16G16B16A16Unorm },
+		{ 1, offsetof(packedVertex, normal), Format::eR16G16Snorm },
+		{ 2, offsetof(packedVertex, tangent), Format::eR16G16Snorm },
+		{ 3, offsetof(packedVertex, texCoord), Format::eR16G16Sfloat } } };
+}
+
+vertexEncoding vertexEncodingOf(const shaderReflection& vertexStage) {
+	if (vertexStage.pushConstantBlock != "positionDequant") {
+		return vertexEncoding::full;
+	}
+	for (const auto& range : vertexStage.pushConstants) {
+		if ((range.stageFlags & ShaderStageFlagBits::eVertex) && range.offset == 0 && range.size >= sizeof(positionDequant)) {
+			return vertexEncoding::quantized;
+		}
+	}
+	return vertexEncoding::full;
+}
+
+const char* to_string(vertexEncoding encoding) {
+	return encoding == vertexEncoding::quantized ? "quantized" : "full";
+}
+
+namespace {
+	int16_t snorm16(float v) {
+		return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	uint16_t unorm16(float v) {
+		return static_cast<uint16_t>(std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	// unit vector to the [-1, 1] square; the lower hemisphere is folded over the diagonals
+	glm::vec2 octEncode(glm::vec3 n) {
+		float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (sum == 0.0f) {
+			return { 0.0f, 0.0f };
+		}
+		glm::vec2 p = glm::vec2(n.x, n.y) / sum;
+		if (n.z < 0.0f) {
+			p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+				(1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		return p;
+	}
+
+	glm::vec3 anyPerpendicular(glm::vec3 n) {
+		glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		return glm::normalize(glm::cross(n, axis));
+	}
+
+	// per-vertex tangents accumulated from the uv gradients of the triangles around each vertex
+	void computeTangents(const meshView& geometry, std::vector<glm::vec4>& out) {
+		std::vector<glm::vec3> tan(geometry.vertexCount, glm::vec3(0.0f));
+		std::vector<glm::vec3> bitan(geometry.vertexCount, glm::vec3(0.0f));
+		const uint32_t* indices = static_cast<const uint32_t*>(geometry.indices);
+		const uint16_t* shortIndices = static_cast<const uint16_t*>(geometry.indices);
+		auto index = [&](uint32_t i) {
+			return geometry.indexSize == sizeof(uint16_t) ? shortIndices[i] : indices[i];
+		};
+
+		// full-detail triangles only; LOD levels reuse the same vertices
+		for (uint32_t s = 0; s < geometry.submeshCount; s++) {
+			const submesh& part = geometry.submeshes[s];
+			for (uint32_t i = part.firstIndex; i + 2 < part.firstIndex + part.indexCount; i += 3) {
+				uint32_t a = index(i), b = index(i + 1), c = index(i + 2);
+				const Vertex& va = geometry.vertices[a];
+				const Vertex& vb = geometry.vertices[b];
+				const Vertex& vc = geometry.vertices[c];
+
+				glm::vec3 e1 = vb.pos - va.pos, e2 = vc.pos - va.pos;
+				glm::vec2 d1 = vb.texCoord - va.texCoord, d2 = vc.texCoord - va.texCoord;
+				float det = d1.x * d2.y - d2.x * d1.y;
+				if (std::abs(det) < 1e-12f) {
+					continue;
+				}
+				float r = 1.0f / det;
+				glm::vec3 t = (e1 * d2.y - e2 * d1.y) * r;
+				glm::vec3 bt = (e2 * d1.x - e1 * d2.x) * r;
+				for (uint32_t v : { a, b, c }) {
+					tan[v] += t;
+					bitan[v] += bt;
+				}
+			}
+		}
+
+		out.resize(geometry.vertexCount);
+		for (uint32_t v = 0; v < geometry.vertexCount; v++) {
+			glm::vec3 n = geometry.vertices[v].normal;
+			float length = glm::length(n);
+			n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+			// Gram-Schmidt against the normal; vertices without a uv gradient get any perpendicular
+			glm::vec3 t = tan[v] - n * glm::dot(n, tan[v]);
+			float tLength = glm::length(t);
+			t = tLength > 1e-8f ? t / tLength : anyPerpendicular(n);
+			float sign = glm::dot(glm::cross(n, t), bitan[v]) < 0.0f ? -1.0f : 1.0f;
+			out[v] = glm::vec4(t, sign);
+		}
+	}
+}
+
+quantizedMesh quantizeMesh(const meshView& geometry) {
+	quantizedMesh q;
+	std::vector<glm::vec4> tangents;
+	computeTangents(geometry, tangents);
+
+	const uint32_t* indices = static_cast<const uint32_t*>(geometry.indices);
+	const uint16_t* shortIndices = static_cast<const uint16_t*>(geometry.indices);
+	auto index = [&](uint32_t i) {
+		return geometry.indexSize == sizeof(uint16_t) ? shortIndices[i] : indices[i];
+	};
+
+	q.indices.resize(geometry.indexCount);
+	q.vertices.reserve(geometry.vertexCount);
+	q.vertexOffsets.reserve(geometry.submeshCount);
+	q.dequant.reserve(geometry.submeshCount);
+
+	// a vertex shared by two submeshes is emitted once for each
+	std::vector<uint32_t> owner(geometry.vertexCount, UINT32_MAX);
+	std::vector<uint32_t> local(geometry.vertexCount);
+	std::vector<uint32_t> used;
+
+	for (uint32_t s = 0; s < geometry.submeshCount; s++) {
+		const submesh& part = geometry.submeshes[s];
+		used.clear();
+		for (uint32_t i = part.firstIndex; i < part.firstIndex + part.indexCount; i++) {
+			uint32_t v = index(i);
+			if (owner[v] != s) {
+				owner[v] = s;
+				local[v] = static_cast<uint32_t>(used.size());
+				used.push_back(v);
+			}
+			q.indices[i] = local[v];
+		}
+		// coarser levels only use vertices the full-detail range already placed
+		for (uint32_t l = 1; l < part.lodCount; l++) {
+			const meshLod& lod = geometry.lods[part.firstLod + l];
+			for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++) {
+				q.indices[i] = local[index(i)];
+			}
+		}
+
+		glm::vec3 lo(0.0f), hi(0.0f);
+		if (!used.empty()) {
+			lo = hi = geometry.vertices[used[0]].pos;
+		}
+		for (uint32_t v : used) {
+			lo = glm::min(lo, geometry.vertices[v].pos);
+			hi = glm::max(hi, geometry.vertices[v].pos);
+		}
+		glm::vec3 extent = hi - lo;
+		glm::vec3 inverse(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+			extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+			extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+		q.vertexOffsets.push_back(static_cast<int32_t>(q.vertices.size()));
+		q.dequant.push_back({ glm::vec4(extent, 0.0f), glm::vec4(lo, 0.0f) });
+		q.maxSubmeshVertices = std::max(q.maxSubmeshVertices, static_cast<uint32_t>(used.size()));
+
+		for (uint32_t v : used) {
+			const Vertex& src = geometry.vertices[v];
+			glm::vec3 unit = (src.pos - lo) * inverse;
+			glm::vec3 n = src.normal;
+			float length = glm::length(n);
+			n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+			glm::vec2 octNormal = octEncode(n);
+			glm::vec2 octTangent = octEncode(glm::vec3(tangents[v]));
+
+			packedVertex packed{
+				.pos = { unorm16(unit.x), unorm16(unit.y), unorm16(unit.z), static_cast<uint16_t>(tangents[v].w < 0.0f ? 0 : 65535) },
+				.normal = { snorm16(octNormal.x), snorm16(octNormal.y) },
+				.tangent = { snorm16(octTangent.x), snorm16(octTangent.y) },
+				.texCoord = { glm::packHalf1x16(src.texCoord.x), glm::packHalf1x16(src.texCoord.y) }
+			};
+			q.vertices.push_back(packed);
+		}
+	}
+
+	return q;
+}